@@ -0,0 +1,78 @@
+// fragment shader, use with: 'ortho_tex.vert'
+// colors the iteration count of every pixel, like {colorizer_apply} does on the cpu
+#version 330 core
+
+// see {palette_t}
+#define PALETTE_HISTOGRAM 0
+#define PALETTE_LINEAR 1
+#define PALETTE_CYCLIC 2
+#define PALETTE_LOG 3
+
+uniform sampler2D tex_sampler;     // iteration count of every pixel
+uniform samplerBuffer hue_sampler; // fraction of the pixels below every integer count, for the histogram palette
+uniform float max_iterations;
+uniform int palette;
+uniform float offset;
+uniform float cycle_speed;
+
+in vec2 tex;
+
+out vec4 frag_color;
+
+// position on the hue circle of iteration count m, without the offset
+float palette_position(float m) {
+    if (palette == PALETTE_LINEAR) {
+        return m / max_iterations;
+    } else if (palette == PALETTE_CYCLIC) {
+        return m * cycle_speed;
+    } else if (palette == PALETTE_LOG) {
+        return log(1.0 + m) / log(1.0 + max_iterations);
+    }
+
+    int n = int(m);
+    float t = m - float(n);
+    return texelFetch(hue_sampler, n).r * (1.0 - t) + texelFetch(hue_sampler, n + 1).r * t;
+}
+
+// integer conversion of a hue with full saturation and value, identical to {HSVtoRGB}
+vec3 hue_to_rgb(int h) {
+    int region = h / 43;
+    int remainder = (h - region * 43) * 6;
+    int q = (255 * (255 - ((255 * remainder) >> 8))) >> 8;
+    int t = (255 * (255 - ((255 * (255 - remainder)) >> 8))) >> 8;
+
+    ivec3 rgb;
+    if (region == 0) {
+        rgb = ivec3(255, t, 0);
+    } else if (region == 1) {
+        rgb = ivec3(q, 255, 0);
+    } else if (region == 2) {
+        rgb = ivec3(0, 255, t);
+    } else if (region == 3) {
+        rgb = ivec3(0, q, 255);
+    } else if (region == 4) {
+        rgb = ivec3(t, 0, 255);
+    } else {
+        rgb = ivec3(255, 0, q);
+    }
+
+    return vec3(rgb) / 255.0;
+}
+
+void main() {
+    float m = texture(tex_sampler, tex).r;
+
+    // interior and undecided pixels are black
+    if (m >= max_iterations) {
+        frag_color = vec4(0.0, 0.0, 0.0, 1.0);
+        return;
+    }
+
+    float position = palette_position(m) + offset;
+    // palettes other than the cyclic one end at exactly one, which is kept as is
+    if (position > 1.0) {
+        position -= floor(position);
+    }
+
+    frag_color = vec4(hue_to_rgb(255 - int(255.0 * position)), 1.0);
+}
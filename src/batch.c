@@ -0,0 +1,996 @@
+#define STB_IMAGE_WRITE_IMPLEMENTATION
+
+#include <stb_image_write.h>
+#include <util/log.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <inttypes.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <time.h>
+#include <math.h>
+#include <signal.h>
+#include <pthread.h>
+#include <util/hp.h>
+#include <util/mandelbrot.h>
+#include <util/colorizer.h>
+#include <util/thread_pool.h>
+#include <util/png_writer.h>
+#include <util/exp_map.h>
+#include <util/tile_server.h>
+#include <util/dzi_writer.h>
+
+/**
+ * Headless renderer, which computes views given on the command line or in a job file and writes them as png,
+ * without a window or GL context. Options given on the command line are the defaults for every job of the job
+ * file, which holds one job per line in the same form, or for the tiles of a tile server. */
+
+const float ADAPTIVE_THRESHOLD = .5f; // difference in iterations to a neighbour that refines a pixel
+#define JOB_LINE_LENGTH 4096          // limit to the number of characters of a line of a job file
+const uint64_t MAX_FRAME_SAMPLES = 1u << 24; // samples of a view above which it is computed in strips
+const uint64_t STRIP_SAMPLES = 1u << 22;     // samples per strip of a view that is computed in strips
+const uint32_t PREVIEW_PIXELS = 1u << 20;    // pixels of the version of a view computed in strips for its histogram
+#define TILE_SIZE 256                        // pixels in both directions of a tile of the tile server
+const uint32_t TILE_MAX_ZOOM = 52;           // deepest zoom level of a tile, of which the center is exact in doubles
+const double TILE_ROOT_RE = -2.5;            // corner of the only tile of zoom level 0
+const double TILE_ROOT_IM = -2.;
+const double TILE_ROOT_EXTENT = 4.;          // width and height of the only tile of zoom level 0
+
+/** View to render and how to color it. */
+typedef struct {
+    // center of the view, in high precision
+    hp_t re_center;
+    hp_t im_center;
+    // width of the view on the real axis, the height follows from the aspect ratio of the image
+    double extent;
+    // size of the image in pixels
+    uint32_t width;
+    uint32_t height;
+    // limit to the number of iterations, or 0 to raise it until the view converges
+    uint32_t max_iterations;
+    // number of samples per pixel in both directions
+    uint32_t samples_per_pixel;
+    // number of rows computed at a time, or 0 to compute large images in strips and others as a whole
+    uint32_t strip_height;
+    // number of frames of a zoom from the view to one of width {end_extent}, or 0 for a single image
+    uint32_t frame_count;
+    double end_extent;
+    color_scheme_t scheme;
+    // path of the png to write, empty to derive it from the number of the job
+    char output[1024];
+} job_t;
+
+static const char *USAGE =
+        "usage: mandelbrot-batch [options] [--jobs file]\n"
+        "  --re decimal       real part of the center (-0.5)\n"
+        "  --im decimal       imaginary part of the center (0)\n"
+        "  --extent width     width of the view on the real axis (3)\n"
+        "  --size WxH         size of the image in pixels (1024x768)\n"
+        "  --maxiter n        maximum number of iterations, 0 raises it until the view converges (0)\n"
+        "  --spp n            samples per pixel in both directions, refined adaptively (1)\n"
+        "  --strip-height n   rows computed at a time, 0 computes images of over 16M samples in strips (0)\n"
+        "  --frames n         renders a zoom video of n frames into the center instead of an image (0)\n"
+        "  --end-extent width width of the view on the real axis of the last frame of a video\n"
+        "  --palette name     histogram, linear, cyclic or log (histogram)\n"
+        "  --offset f         position on the hue circle the palette starts at, in [0, 1) (0)\n"
+        "  --cycle f          number of hue circles per iteration of the cyclic palette (0.03125)\n"
+        "  --output path      png to write (mandelbrot.png, or job-N.png for line N of a job file), frames of a\n"
+        "                     video are numbered (path-00000.png), an image or frames are written to stdout as\n"
+        "                     raw rgb24 if path is -, a path ending in .dzi writes a Deep Zoom pyramid of tiles\n"
+        "                     into path_files instead\n"
+        "  --threads n        number of workers, 0 for one per processor (0)\n"
+        "  --jobs file        renders every line of {file}, each holding options in the form above\n"
+        "  --serve port       serves tiles at http://127.0.0.1:port/z/x/y.png and statistics at /stats, using\n"
+        "                     --maxiter, --spp and the palette of the options above, until interrupted\n"
+        "  --cache-mb n       megabytes of encoded tiles the tile server keeps (256)\n";
+
+/** Parses an unsigned integer that makes up all of {t_value}. */
+static int parse_uint(const char *t_value, uint32_t *t_result)
+{
+    char *end;
+    unsigned long value = strtoul(t_value, &end, 10);
+    if (end == t_value || *end != '\0' || t_value[0] == '-' || value > UINT32_MAX) return EXIT_FAILURE;
+    *t_result = (uint32_t) value;
+
+    return EXIT_SUCCESS;
+}
+
+/** Parses a finite floating point number that makes up all of {t_value}. */
+static int parse_double(const char *t_value, double *t_result)
+{
+    char *end;
+    double value = strtod(t_value, &end);
+    if (end == t_value || *end != '\0' || !isfinite(value)) return EXIT_FAILURE;
+    *t_result = value;
+
+    return EXIT_SUCCESS;
+}
+
+/** Applies option {t_name}, without leading dashes, with {t_value} to {t_job}. */
+static int parse_job_option(job_t *t_job, const char *t_name, const char *t_value)
+{
+    double d;
+    if (strcmp(t_name, "re") == 0) {
+        return hp_from_string(t_value, &t_job->re_center);
+    } else if (strcmp(t_name, "im") == 0) {
+        return hp_from_string(t_value, &t_job->im_center);
+    } else if (strcmp(t_name, "extent") == 0) {
+        if (parse_double(t_value, &d) == EXIT_FAILURE || d <= 0) return EXIT_FAILURE;
+        t_job->extent = d;
+    } else if (strcmp(t_name, "size") == 0) {
+        uint32_t w, h;
+        char rest;
+        if (sscanf(t_value, "%ux%u%c", &w, &h, &rest) != 2 || w == 0 || h == 0) return EXIT_FAILURE;
+        t_job->width = w;
+        t_job->height = h;
+    } else if (strcmp(t_name, "maxiter") == 0) {
+        if (parse_uint(t_value, &t_job->max_iterations) == EXIT_FAILURE) return EXIT_FAILURE;
+        if (t_job->max_iterations > MAX_ITER_LIMIT) return EXIT_FAILURE;
+    } else if (strcmp(t_name, "spp") == 0) {
+        if (parse_uint(t_value, &t_job->samples_per_pixel) == EXIT_FAILURE) return EXIT_FAILURE;
+        if (t_job->samples_per_pixel == 0) return EXIT_FAILURE;
+    } else if (strcmp(t_name, "strip-height") == 0) {
+        if (parse_uint(t_value, &t_job->strip_height) == EXIT_FAILURE) return EXIT_FAILURE;
+    } else if (strcmp(t_name, "frames") == 0) {
+        if (parse_uint(t_value, &t_job->frame_count) == EXIT_FAILURE) return EXIT_FAILURE;
+    } else if (strcmp(t_name, "end-extent") == 0) {
+        if (parse_double(t_value, &d) == EXIT_FAILURE || d <= 0) return EXIT_FAILURE;
+        t_job->end_extent = d;
+    } else if (strcmp(t_name, "palette") == 0) {
+        uint32_t palette = 0;
+        while (palette < PALETTE_COUNT && strcmp(t_value, PALETTE_NAMES[palette]) != 0) palette++;
+        if (palette == PALETTE_COUNT) return EXIT_FAILURE;
+        t_job->scheme.palette = (palette_t) palette;
+    } else if (strcmp(t_name, "offset") == 0) {
+        if (parse_double(t_value, &d) == EXIT_FAILURE) return EXIT_FAILURE;
+        t_job->scheme.offset = (float) (d - floor(d));
+    } else if (strcmp(t_name, "cycle") == 0) {
+        if (parse_double(t_value, &d) == EXIT_FAILURE) return EXIT_FAILURE;
+        t_job->scheme.cycle_speed = (float) d;
+    } else if (strcmp(t_name, "output") == 0) {
+        if (strlen(t_value) >= sizeof(t_job->output)) return EXIT_FAILURE;
+        strcpy(t_job->output, t_value);
+    } else {
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
+
+/**
+ * Applies {t_count} options of the form --name value from {t_args} to {t_job}.
+ * {t_source} names where the options come from, for errors. */
+static int parse_job_options(job_t *t_job, int t_count, char **t_args, const char *t_source)
+{
+    for (int i = 0; i < t_count; i += 2) {
+        if (strncmp(t_args[i], "--", 2) != 0 || i + 1 == t_count) {
+            nm_log(LOG_ERROR, "%s: expected an option followed by a value at '%s'\n", t_source, t_args[i]);
+            return EXIT_FAILURE;
+        }
+        if (parse_job_option(t_job, t_args[i] + 2, t_args[i + 1]) == EXIT_FAILURE) {
+            nm_log(LOG_ERROR, "%s: invalid option '%s %s'\n", t_source, t_args[i], t_args[i + 1]);
+            return EXIT_FAILURE;
+        }
+    }
+
+    return EXIT_SUCCESS;
+}
+
+/** Returns the view of {t_job}, in the form {generate} takes. */
+static Fractal job_fractal(const job_t *t_job)
+{
+    Fractal fractal = {
+            .re_center = t_job->re_center,
+            .im_center = t_job->im_center,
+            .re_size = t_job->extent,
+            .im_size = t_job->extent * t_job->height / t_job->width,
+            .scale = 0,
+    };
+
+    // moves the exponent of the size into the scale
+    return zoom_fractal(fractal, 0., 0., 1., 1.);
+}
+
+static double elapsed_seconds(const struct timespec *t_start)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    return (double) (now.tv_sec - t_start->tv_sec) + (now.tv_nsec - t_start->tv_nsec) * 1e-9;
+}
+
+/** Changes the size of {t_buffer}, the contents are undefined afterwards. On failure the size is kept. */
+static int resize_buffer(IterationBuffer *t_buffer, uint32_t t_width, uint32_t t_height)
+{
+    if ((size_t) t_buffer->width * t_buffer->height != (size_t) t_width * t_height) {
+        float *data = realloc(t_buffer->data, sizeof(float) * t_width * t_height);
+        if (data == NULL) {
+            nm_log(LOG_ERROR, "could not allocate memory for iterations of %ux%u\n", t_width, t_height);
+
+            return EXIT_FAILURE;
+        }
+        t_buffer->data = data;
+    }
+    t_buffer->width = t_width;
+    t_buffer->height = t_height;
+
+    return EXIT_SUCCESS;
+}
+
+/**
+ * Computes the iterations of {t_fractal} into {t_buffer}, up to {t_max_iterations} or, if that is 0, while
+ * the maximum is raised until the view converges. Returns the maximum that was used, or 0 if the view has too
+ * many samples or memory for them could not be allocated. */
+static uint32_t compute_view(
+        IterationBuffer *t_buffer, IterationState *t_state, Fractal t_fractal, uint32_t t_max_iterations,
+        uint32_t t_samples_per_pixel, thread_pool_t *t_pool
+)
+{
+    uint32_t spp = t_samples_per_pixel;
+    uint32_t maxiter = t_max_iterations > 0 ? t_max_iterations : INITIAL_MAX_ITER;
+    while (true) {
+        // the same view continues from the state of the previous pass
+        if (generate(t_buffer, t_state, t_fractal, maxiter, spp, spp, t_pool, NULL, NULL, NULL) == EXIT_FAILURE) {
+            return 0;
+        }
+        if (t_max_iterations > 0 || iteration_state_converged(t_state)) break;
+        maxiter = next_max_iterations(maxiter);
+    }
+
+    return maxiter;
+}
+
+/** Returns the number of rows of {t_job} that are computed at a time, all of them if it is not too large. */
+static uint32_t job_strip_height(const job_t *t_job)
+{
+    if (t_job->strip_height > 0) {
+        return t_job->strip_height < t_job->height ? t_job->strip_height : t_job->height;
+    }
+
+    uint64_t samples_per_row = (uint64_t) t_job->width * t_job->samples_per_pixel * t_job->samples_per_pixel;
+    if (samples_per_row * t_job->height <= MAX_FRAME_SAMPLES) return t_job->height;
+    uint64_t rows = STRIP_SAMPLES / samples_per_row;
+
+    return rows == 0 ? 1 : rows < t_job->height ? (uint32_t) rows : t_job->height;
+}
+
+/** Whether {t_rows} rows of {t_width} pixels of {t_spp} by {t_spp} samples are few enough for {generate}. */
+static bool samples_fit(uint32_t t_width, uint32_t t_rows, uint32_t t_spp)
+{
+    return (double) t_width * t_rows * t_spp * t_spp <= UINT32_MAX;
+}
+
+/** Turns {t_count} RGBA pixels into RGB ones in place, as the alpha of every color is opaque. */
+static void drop_alpha(uint8_t *t_pixels, uint32_t t_count)
+{
+    for (uint32_t i = 0; i < t_count; i++) {
+        memmove(&t_pixels[i * 3], &t_pixels[i * 4], 3);
+    }
+}
+
+/** Writes {t_rows} rows of {t_width} RGB {t_pixels} to stdout as raw rgb24, for an output of -. */
+static int write_raw_rows(const uint8_t *t_pixels, uint32_t t_width, uint32_t t_rows)
+{
+    size_t count = (size_t) t_width * t_rows;
+
+    return fwrite(t_pixels, 3, count, stdout) == count ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+/**
+ * Computes {t_job} as a whole into {t_buffer}, and writes it colored to {t_output}, or to stdout as raw rgb24
+ * if it is -. */
+static int render_frame(
+        const job_t *t_job, uint32_t t_index, const char *t_output, IterationBuffer *t_buffer,
+        IterationState *t_state, colorizer_t *t_colorizer, thread_pool_t *t_pool
+)
+{
+    if (resize_buffer(t_buffer, t_job->width, t_job->height) == EXIT_FAILURE) return EXIT_FAILURE;
+    uint32_t maxiter = compute_view(
+            t_buffer, t_state, job_fractal(t_job), t_job->max_iterations, t_job->samples_per_pixel, t_pool
+    );
+    if (maxiter == 0) {
+        nm_log(LOG_ERROR, "job %u: failed to compute the view\n", t_index);
+        return EXIT_FAILURE;
+    }
+
+    if (colorizer_set_iterations(t_colorizer, t_buffer->data, t_buffer->width, t_buffer->height, maxiter) ==
+        EXIT_FAILURE) {
+        nm_log(LOG_ERROR, "job %u: failed to keep the iterations\n", t_index);
+        return EXIT_FAILURE;
+    }
+
+    const uint32_t channels = 4;
+    uint8_t *pixels = malloc(sizeof(uint8_t) * t_job->width * t_job->height * channels);
+    if (pixels == NULL) {
+        nm_log(LOG_ERROR, "job %u: could not allocate memory for the pixels\n", t_index);
+        return EXIT_FAILURE;
+    }
+    int written = colorizer_apply(t_colorizer, t_job->scheme, pixels) == EXIT_SUCCESS;
+    if (written && strcmp(t_output, "-") == 0) {
+        drop_alpha(pixels, t_job->width * t_job->height);
+        written = write_raw_rows(pixels, t_job->width, t_job->height) == EXIT_SUCCESS && fflush(stdout) == 0;
+    } else if (written) {
+        written = stbi_write_png(
+                t_output, (int) t_job->width, (int) t_job->height, channels, pixels,
+                (int32_t) (t_job->width * channels)
+        );
+    }
+    free(pixels);
+    if (!written) {
+        nm_log(LOG_ERROR, "job %u: failed to write '%s'\n", t_index, t_output);
+        return EXIT_FAILURE;
+    }
+    nm_log(LOG_INFO, "job %u: computed with max_iter=%u\n", t_index, maxiter);
+
+    return EXIT_SUCCESS;
+}
+
+/**
+ * Computes a smaller version of {t_job}, at one sample per pixel and the same aspect ratio, for the maximum if
+ * the job does not give it and the histogram the parts of the job are colored with. Returns the maximum, or 0
+ * if memory for the pre-pass or its histogram could not be allocated. */
+static uint32_t compute_preview(
+        const job_t *t_job, uint32_t t_index, IterationBuffer *t_buffer, IterationState *t_state,
+        colorizer_t *t_colorizer, thread_pool_t *t_pool
+)
+{
+    uint32_t w = t_job->width;
+    uint32_t h = t_job->height;
+    double preview_scale = sqrt(PREVIEW_PIXELS / ((double) w * h));
+    uint32_t preview_w = preview_scale < 1. ? (uint32_t) fmax(1., w * preview_scale) : w;
+    uint32_t preview_h = preview_scale < 1. ? (uint32_t) fmax(1., h * preview_scale) : h;
+    if (resize_buffer(t_buffer, preview_w, preview_h) == EXIT_FAILURE) return 0;
+    uint32_t maxiter = compute_view(t_buffer, t_state, job_fractal(t_job), t_job->max_iterations, 1, t_pool);
+    if (maxiter == 0) {
+        nm_log(LOG_ERROR, "job %u: failed to compute the pre-pass\n", t_index);
+        return 0;
+    }
+    if (colorizer_set_iterations(t_colorizer, t_buffer->data, preview_w, preview_h, maxiter) == EXIT_FAILURE) {
+        nm_log(LOG_ERROR, "job %u: failed to keep the pre-pass\n", t_index);
+        return 0;
+    }
+    nm_log(LOG_INFO, "job %u: pre-pass of %ux%u set max_iter=%u\n", t_index, preview_w, preview_h, maxiter);
+
+    return maxiter;
+}
+
+/**
+ * Computes the {t_height} rows of {t_job} from row {t_y} on up to {t_max_iterations}, and colors them into
+ * {t_pixels} as RGB. The rows have the same coordinates as in the view as a whole. */
+static int compute_rows(
+        const job_t *t_job, uint32_t t_y, uint32_t t_height, uint32_t t_max_iterations, uint8_t *t_pixels,
+        IterationBuffer *t_buffer, IterationState *t_state, colorizer_t *t_colorizer, thread_pool_t *t_pool
+)
+{
+    uint32_t w = t_job->width;
+    uint32_t h = t_job->height;
+    if (resize_buffer(t_buffer, w, t_height) == EXIT_FAILURE) return EXIT_FAILURE;
+    Fractal strip = zoom_fractal(job_fractal(t_job), 0., (t_y + t_height / 2.) / h - .5, 1., t_height / (double) h);
+    if (generate(
+            t_buffer, t_state, strip, t_max_iterations, t_job->samples_per_pixel, t_job->samples_per_pixel, t_pool,
+            NULL, NULL, NULL
+    ) == EXIT_FAILURE) {
+        return EXIT_FAILURE;
+    }
+
+    if (colorizer_apply_to(t_colorizer, t_job->scheme, t_buffer->data, w * t_height, t_pixels) == EXIT_FAILURE) {
+        return EXIT_FAILURE;
+    }
+    drop_alpha(t_pixels, w * t_height);
+
+    return EXIT_SUCCESS;
+}
+
+/**
+ * Computes {t_job} in strips of {t_strip_height} rows, and streams them colored to {t_output}, or to stdout if it
+ * is -, so that memory is proportional to the strip rather than the image. A pre-pass over a smaller version of
+ * the view finds the maximum, if the job does not give it, and the histogram all strips are colored with. */
+static int render_strips(
+        const job_t *t_job, uint32_t t_index, const char *t_output, uint32_t t_strip_height,
+        IterationBuffer *t_buffer, IterationState *t_state, colorizer_t *t_colorizer, thread_pool_t *t_pool
+)
+{
+    uint32_t w = t_job->width;
+    uint32_t h = t_job->height;
+    uint32_t maxiter = compute_preview(t_job, t_index, t_buffer, t_state, t_colorizer, t_pool);
+    if (maxiter == 0) return EXIT_FAILURE;
+
+    bool raw = strcmp(t_output, "-") == 0;
+    png_writer_t writer;
+    if (!raw && create_png_writer(&writer, t_output, w, h, 3) == EXIT_FAILURE) {
+        nm_log(LOG_ERROR, "job %u: failed to create '%s'\n", t_index, t_output);
+        return EXIT_FAILURE;
+    }
+
+    /** compute, color and write every strip, the maximum is fixed so that strips match */
+    int result = EXIT_SUCCESS;
+    uint8_t *pixels = malloc(sizeof(uint8_t) * w * t_strip_height * 4);
+    if (pixels == NULL) {
+        nm_log(LOG_ERROR, "job %u: could not allocate memory for the pixels of a strip\n", t_index);
+        result = EXIT_FAILURE;
+    }
+    for (uint32_t y = 0; y < h && result == EXIT_SUCCESS; y += t_strip_height) {
+        uint32_t strip_h = y + t_strip_height < h ? t_strip_height : h - y;
+        result = compute_rows(t_job, y, strip_h, maxiter, pixels, t_buffer, t_state, t_colorizer, t_pool);
+        if (result == EXIT_SUCCESS && raw) {
+            result = write_raw_rows(pixels, w, strip_h);
+        } else if (result == EXIT_SUCCESS) {
+            png_writer_write_rows(&writer, pixels, strip_h);
+        }
+        nm_log(LOG_TRACE, "job %u: wrote rows %u to %u\n", t_index, y, y + strip_h);
+    }
+    free(pixels);
+
+    // the png writer fails for an image that is missing rows
+    if ((raw ? fflush(stdout) != 0 : delete_png_writer(&writer) == EXIT_FAILURE) || result == EXIT_FAILURE) {
+        nm_log(LOG_ERROR, "job %u: failed to write '%s'\n", t_index, t_output);
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
+
+/**
+ * Computes {t_job} in strips of {t_strip_height} rows like {render_strips}, as the finest level of a Deep Zoom
+ * pyramid described by {t_output}. Only the finest level is computed, the coarser levels are downsampled from
+ * it as its rows of tiles complete, see {dzi_writer_t}. */
+static int render_pyramid(
+        const job_t *t_job, uint32_t t_index, const char *t_output, uint32_t t_strip_height,
+        IterationBuffer *t_buffer, IterationState *t_state, colorizer_t *t_colorizer, thread_pool_t *t_pool
+)
+{
+    uint32_t w = t_job->width;
+    uint32_t h = t_job->height;
+    uint32_t maxiter = compute_preview(t_job, t_index, t_buffer, t_state, t_colorizer, t_pool);
+    if (maxiter == 0) return EXIT_FAILURE;
+
+    // allocated before the directories are created, so that none are left behind on failure
+    uint8_t *pixels = malloc(sizeof(uint8_t) * w * t_strip_height * 4);
+    if (pixels == NULL) {
+        nm_log(LOG_ERROR, "job %u: could not allocate memory for the pixels of a strip\n", t_index);
+        return EXIT_FAILURE;
+    }
+
+    dzi_writer_t writer;
+    if (create_dzi_writer(&writer, t_output, w, h, t_pool) == EXIT_FAILURE) {
+        nm_log(LOG_ERROR, "job %u: failed to create the directories of '%s'\n", t_index, t_output);
+        free(pixels);
+
+        return EXIT_FAILURE;
+    }
+
+    for (uint32_t y = 0; y < h; y += t_strip_height) {
+        uint32_t strip_h = y + t_strip_height < h ? t_strip_height : h - y;
+        if (compute_rows(t_job, y, strip_h, maxiter, pixels, t_buffer, t_state, t_colorizer, t_pool) ==
+            EXIT_FAILURE || dzi_writer_write_rows(&writer, pixels, strip_h) == EXIT_FAILURE) {
+            break;
+        }
+        nm_log(LOG_TRACE, "job %u: added rows %u to %u to the pyramid\n", t_index, y, y + strip_h);
+    }
+    free(pixels);
+
+    uint32_t level_count = writer.m_level_count;
+    uint64_t tile_count = writer.m_tile_count;
+    if (delete_dzi_writer(&writer) == EXIT_FAILURE) {
+        nm_log(LOG_ERROR, "job %u: failed to write the pyramid of '%s'\n", t_index, t_output);
+        return EXIT_FAILURE;
+    }
+    nm_log(LOG_INFO, "job %u: wrote %u levels of %" PRIu64 " tiles\n", t_index, level_count, tile_count);
+
+    return EXIT_SUCCESS;
+}
+
+/**
+ * Writes frame {t_frame} of {t_width} by {t_height} RGB {t_pixels} of a video to {t_output}, with the number of
+ * the frame inserted before the extension, or to stdout if {t_output} is -. */
+static int write_video_frame(
+        const char *t_output, uint32_t t_frame, const uint8_t *t_pixels, uint32_t t_width, uint32_t t_height
+)
+{
+    if (strcmp(t_output, "-") == 0) return write_raw_rows(t_pixels, t_width, t_height);
+
+    size_t length = strlen(t_output);
+    if (length >= 4 && strcmp(&t_output[length - 4], ".png") == 0) length -= 4;
+    char path[sizeof(((job_t *) NULL)->output) + 16];
+    snprintf(path, sizeof(path), "%.*s-%05u.png", (int) length, t_output, t_frame);
+
+    png_writer_t writer;
+    if (create_png_writer(&writer, path, t_width, t_height, 3) == EXIT_FAILURE) return EXIT_FAILURE;
+    png_writer_write_rows(&writer, t_pixels, t_height);
+
+    return delete_png_writer(&writer);
+}
+
+/**
+ * Renders a zoom of {m_frame_count} frames from the view of {t_job} to one of {m_end_extent} wide, at a constant
+ * speed, to {t_output}. Only the last frame is computed as a view, the others are resampled from an exponential
+ * map around the center and from the last frame, see {exp_map_render}. The last frame also gives the maximum, if
+ * the job does not, and the histogram all frames are colored with. */
+static int render_video(
+        const job_t *t_job, uint32_t t_index, const char *t_output, IterationBuffer *t_buffer,
+        IterationState *t_state, colorizer_t *t_colorizer, thread_pool_t *t_pool
+)
+{
+    uint32_t w = t_job->width;
+    uint32_t h = t_job->height;
+    if (t_job->end_extent <= 0. || t_job->end_extent >= t_job->extent) {
+        nm_log(LOG_ERROR, "job %u: a video needs an end extent smaller than the extent\n", t_index);
+        return EXIT_FAILURE;
+    }
+
+    /** last frame, at full quality */
+    job_t last = *t_job;
+    last.extent = t_job->end_extent;
+    if (resize_buffer(t_buffer, w, h) == EXIT_FAILURE) return EXIT_FAILURE;
+    uint32_t maxiter = compute_view(
+            t_buffer, t_state, job_fractal(&last), t_job->max_iterations, t_job->samples_per_pixel, t_pool
+    );
+    if (maxiter == 0) {
+        nm_log(LOG_ERROR, "job %u: failed to compute the last frame\n", t_index);
+        return EXIT_FAILURE;
+    }
+    if (colorizer_set_iterations(t_colorizer, t_buffer->data, w, h, maxiter) == EXIT_FAILURE) {
+        nm_log(LOG_ERROR, "job %u: failed to keep the last frame\n", t_index);
+        return EXIT_FAILURE;
+    }
+    nm_log(LOG_INFO, "job %u: last frame set max_iter=%u\n", t_index, maxiter);
+
+    /** map from the corners of the first frame to the edge of the circle inside the last frame */
+    double start_spacing = t_job->extent / w;
+    double end_spacing = t_job->end_extent / w;
+    double half_diagonal = sqrt((double) w * w + (double) h * h) / 2.;
+    double inner_radius = ((w < h ? w : h) / 2. - 1.) * end_spacing;
+    // as many columns as pixels on the circle through the corners, so that level 0 is as fine as the frame there
+    uint32_t columns = (uint32_t) ceil(2. * M_PI * half_diagonal);
+    double octaves = log2(half_diagonal * start_spacing / inner_radius);
+    uint32_t level_count = 1 + (octaves > 0. ? (uint32_t) ceil(octaves) : 0);
+    exp_map_t map;
+    if (create_exp_map(
+            &map, t_job->re_center, t_job->im_center, half_diagonal * start_spacing, columns, level_count, maxiter
+    ) == EXIT_FAILURE) {
+        nm_log(LOG_ERROR, "job %u: failed to create the map of the zoom\n", t_index);
+        return EXIT_FAILURE;
+    }
+
+    /** frames, at a constant zoom speed */
+    int result = EXIT_SUCCESS;
+    float *frame = malloc(sizeof(float) * w * h);
+    uint8_t *pixels = malloc(sizeof(uint8_t) * w * h * 4);
+    if (frame == NULL || pixels == NULL) {
+        nm_log(LOG_ERROR, "job %u: could not allocate memory for frames of %ux%u\n", t_index, w, h);
+        result = EXIT_FAILURE;
+    }
+    for (uint32_t f = 0; f < t_job->frame_count && result == EXIT_SUCCESS; f++) {
+        double t = t_job->frame_count > 1 ? f / (t_job->frame_count - 1.) : 1.;
+        double spacing = start_spacing * pow(end_spacing / start_spacing, t);
+
+        // the last frame is the one computed as a view
+        const float *iterations = t_buffer->data;
+        if (f + 1 < t_job->frame_count) {
+            if (exp_map_render(&map, frame, w, h, spacing, t_buffer->data, end_spacing, inner_radius, t_pool) ==
+                EXIT_FAILURE) {
+                nm_log(LOG_ERROR, "job %u: failed to resample frame %u\n", t_index, f);
+                result = EXIT_FAILURE;
+                break;
+            }
+            iterations = frame;
+        }
+
+        if (colorizer_apply_to(t_colorizer, t_job->scheme, iterations, w * h, pixels) == EXIT_FAILURE) {
+            result = EXIT_FAILURE;
+            break;
+        }
+        drop_alpha(pixels, w * h);
+        if (write_video_frame(t_output, f, pixels, w, h) == EXIT_FAILURE) {
+            nm_log(LOG_ERROR, "job %u: failed to write frame %u\n", t_index, f);
+            result = EXIT_FAILURE;
+        }
+        nm_log(LOG_TRACE, "job %u: wrote frame %u\n", t_index, f);
+    }
+    fflush(stdout);
+    free(pixels);
+    free(frame);
+
+    nm_log(
+            LOG_INFO, "job %u: %u frames from %" PRIu64 " samples of the map, %.3f per pixel\n", t_index,
+            t_job->frame_count, map.m_sample_count, map.m_sample_count / ((double) w * h * t_job->frame_count)
+    );
+    delete_exp_map(&map);
+
+    return result;
+}
+
+/**
+ * Computes {t_job}, with the help of {t_buffer}, {t_state} and {t_colorizer} which are kept between jobs, and
+ * writes it to the output of the job. {t_index} is the number of the job. */
+static int render_job(
+        const job_t *t_job, uint32_t t_index, IterationBuffer *t_buffer, IterationState *t_state,
+        colorizer_t *t_colorizer, thread_pool_t *t_pool
+)
+{
+    struct timespec start;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+
+    // a video goes as deep as its last frame
+    job_t deepest = *t_job;
+    if (t_job->frame_count > 0) deepest.extent = t_job->end_extent;
+    Fractal fractal = job_fractal(&deepest);
+    double spacing = fabs(fractal_re_size(fractal)) / t_job->width;
+    if (spacing < MIN_SPACING) {
+        nm_log(LOG_ERROR, "job %u: the view is too deep, the spacing between pixels is %g\n", t_index, spacing);
+        return EXIT_FAILURE;
+    }
+
+    char output[sizeof(t_job->output)];
+    if (t_job->output[0] != '\0') {
+        strcpy(output, t_job->output);
+    } else {
+        snprintf(output, sizeof(output), "job-%u.png", t_index);
+    }
+
+    // a video computes its last frame as a whole, other jobs a strip at a time
+    uint32_t strip_height = job_strip_height(t_job);
+    uint32_t rows = t_job->frame_count > 0 ? t_job->height : strip_height;
+    if (!samples_fit(t_job->width, rows, t_job->samples_per_pixel)) {
+        nm_log(
+                LOG_ERROR, "job %u: %u rows of %u pixels of %ux%u samples at a time are more than %u samples\n",
+                t_index, rows, t_job->width, t_job->samples_per_pixel, t_job->samples_per_pixel, UINT32_MAX
+        );
+        return EXIT_FAILURE;
+    }
+
+    int result;
+    if (t_job->frame_count > 0) {
+        result = render_video(t_job, t_index, output, t_buffer, t_state, t_colorizer, t_pool);
+    } else if (strlen(output) > 4 && strcmp(&output[strlen(output) - 4], ".dzi") == 0) {
+        result = render_pyramid(t_job, t_index, output, strip_height, t_buffer, t_state, t_colorizer, t_pool);
+    } else if (strip_height == t_job->height) {
+        result = render_frame(t_job, t_index, output, t_buffer, t_state, t_colorizer, t_pool);
+    } else {
+        result = render_strips(t_job, t_index, output, strip_height, t_buffer, t_state, t_colorizer, t_pool);
+    }
+    if (result == EXIT_SUCCESS && t_job->frame_count > 0) {
+        nm_log(
+                LOG_INFO, "job %u: wrote %u frames of %ux%u to '%s' in %.3fs\n", t_index, t_job->frame_count,
+                t_job->width, t_job->height, output, elapsed_seconds(&start)
+        );
+    } else if (result == EXIT_SUCCESS) {
+        nm_log(
+                LOG_INFO, "job %u: wrote %ux%u to '%s' in %.3fs\n", t_index, t_job->width, t_job->height, output,
+                elapsed_seconds(&start)
+        );
+    }
+
+    return result;
+}
+
+/**
+ * Renders every line of {t_path} as a job, starting from the options in {t_defaults}. Blank lines and lines
+ * starting with # are skipped. A job that fails does not stop the others. */
+static int render_job_file(
+        const char *t_path, const job_t *t_defaults, IterationBuffer *t_buffer, IterationState *t_state,
+        colorizer_t *t_colorizer, thread_pool_t *t_pool
+)
+{
+    FILE *file = fopen(t_path, "r");
+    if (file == NULL) {
+        nm_log(LOG_ERROR, "failed to open job file '%s'\n", t_path);
+        return EXIT_FAILURE;
+    }
+
+    char *line = malloc(JOB_LINE_LENGTH);
+    if (line == NULL) {
+        nm_log(LOG_ERROR, "could not allocate memory for the lines of '%s'\n", t_path);
+        fclose(file);
+        return EXIT_FAILURE;
+    }
+
+    int result = EXIT_SUCCESS;
+    char *args[JOB_LINE_LENGTH / 2];
+    char source[64];
+    uint32_t line_number = 0;
+    uint32_t failed = 0;
+    while (fgets(line, (int) JOB_LINE_LENGTH, file) != NULL) {
+        line_number++;
+
+        // the rest of a line that does not fit is skipped, rather than read as another job
+        size_t length = strlen(line);
+        if (line[length - 1] != '\n' && !feof(file)) {
+            nm_log(
+                    LOG_ERROR, "%s:%u: line is longer than %d characters\n", t_path, line_number,
+                    JOB_LINE_LENGTH - 2
+            );
+            int c;
+            while ((c = fgetc(file)) != EOF && c != '\n');
+            failed++;
+            result = EXIT_FAILURE;
+            continue;
+        }
+
+        // split into words, the options of a line are in the same form as those on the command line
+        int count = 0;
+        for (char *word = strtok(line, " \t\r\n"); word != NULL; word = strtok(NULL, " \t\r\n")) {
+            args[count++] = word;
+        }
+        if (count == 0 || args[0][0] == '#') continue;
+
+        job_t job = *t_defaults;
+        // lines do not share the output of the command line, unless they name it themselves
+        job.output[0] = '\0';
+        snprintf(source, sizeof(source), "%s:%u", t_path, line_number);
+        if (parse_job_options(&job, count, args, source) == EXIT_FAILURE ||
+            render_job(&job, line_number, t_buffer, t_state, t_colorizer, t_pool) == EXIT_FAILURE) {
+            failed++;
+            result = EXIT_FAILURE;
+        }
+    }
+    if (failed > 0) {
+        nm_log(LOG_WARN, "%u jobs of '%s' failed\n", failed, t_path);
+    }
+
+    free(line);
+    fclose(file);
+
+    return result;
+}
+
+/** Computes the tiles of a tile server, one at a time with all workers. */
+typedef struct {
+    // maximum, samples per pixel and palette of every tile
+    job_t job;
+    // protects the buffer, state and colorizer, which are shared by all tiles
+    pthread_mutex_t mutex;
+    IterationBuffer *buffer;
+    IterationState *state;
+    colorizer_t *colorizer;
+    thread_pool_t *pool;
+} tile_renderer_t;
+
+/** Png encoded in memory. */
+typedef struct {
+    uint8_t *data;
+    size_t size;
+    size_t capacity;
+    // set once the data could not grow, after which nothing is appended anymore
+    bool failed;
+} png_buffer_t;
+
+/** Appends {t_size} bytes of {t_data} to the {png_buffer_t} {t_context}, for {stbi_write_png_to_func}. */
+static void append_png(void *t_context, void *t_data, int t_size)
+{
+    png_buffer_t *png = t_context;
+    if (png->failed) return;
+    if (png->size + t_size > png->capacity) {
+        size_t capacity = (png->size + t_size) * 2;
+        uint8_t *data = realloc(png->data, capacity);
+        if (data == NULL) {
+            nm_log(LOG_ERROR, "could not grow encoded png beyond %zu bytes\n", png->size);
+            png->failed = true;
+            return;
+        }
+        png->data = data;
+        png->capacity = capacity;
+    }
+    memcpy(&png->data[png->size], t_data, t_size);
+    png->size += t_size;
+}
+
+/**
+ * Renders tile {t_x}, {t_y} of zoom level {t_z} as png, for {tile_server_t}. Level z splits the square of
+ * {TILE_ROOT_EXTENT} wide with its corner at {TILE_ROOT_RE} + {TILE_ROOT_IM}i into 2^z by 2^z tiles, of which
+ * the imaginary part grows with y, like it does with the rows of the image of a job. */
+static int render_tile(uint32_t t_z, uint64_t t_x, uint64_t t_y, uint8_t **t_data, size_t *t_size, void *t_arg)
+{
+    tile_renderer_t *renderer = t_arg;
+    job_t job = renderer->job;
+    job.extent = ldexp(TILE_ROOT_EXTENT, -(int) t_z);
+    job.width = TILE_SIZE;
+    job.height = TILE_SIZE;
+    // the offset of the center to the corner is exact in doubles up to {TILE_MAX_ZOOM} and below 4, within the range
+    // of {hp_from_double}, the sum with the corner is not
+    job.re_center = hp_add(hp_from_double(TILE_ROOT_RE), hp_from_double((t_x + .5) * job.extent));
+    job.im_center = hp_add(hp_from_double(TILE_ROOT_IM), hp_from_double((t_y + .5) * job.extent));
+
+    uint8_t *pixels = malloc(sizeof(uint8_t) * TILE_SIZE * TILE_SIZE * 4);
+    if (pixels == NULL) {
+        nm_log(LOG_ERROR, "could not allocate memory for the pixels of a tile\n");
+        return EXIT_FAILURE;
+    }
+    int colored;
+    pthread_mutex_lock(&renderer->mutex);
+    {
+        colored = resize_buffer(renderer->buffer, TILE_SIZE, TILE_SIZE);
+        if (colored == EXIT_SUCCESS) {
+            uint32_t maxiter = compute_view(
+                    renderer->buffer, renderer->state, job_fractal(&job), job.max_iterations, job.samples_per_pixel,
+                    renderer->pool
+            );
+            colored = maxiter == 0 ? EXIT_FAILURE : colorizer_set_iterations(
+                    renderer->colorizer, renderer->buffer->data, TILE_SIZE, TILE_SIZE, maxiter
+            );
+        }
+        if (colored == EXIT_SUCCESS) colored = colorizer_apply(renderer->colorizer, job.scheme, pixels);
+    }
+    pthread_mutex_unlock(&renderer->mutex);
+    if (colored == EXIT_FAILURE) {
+        free(pixels);
+        return EXIT_FAILURE;
+    }
+
+    // encoded outside of the lock, so that it overlaps with the computation of the next tile
+    drop_alpha(pixels, TILE_SIZE * TILE_SIZE);
+    png_buffer_t png = {0};
+    int written = stbi_write_png_to_func(append_png, &png, TILE_SIZE, TILE_SIZE, 3, pixels, TILE_SIZE * 3);
+    free(pixels);
+    if (!written || png.failed) {
+        free(png.data);
+        return EXIT_FAILURE;
+    }
+    *t_data = png.data;
+    *t_size = png.size;
+
+    return EXIT_SUCCESS;
+}
+
+static volatile sig_atomic_t stop_serving = 0;
+
+static void handle_stop(int t_signal)
+{
+    stop_serving = 1;
+}
+
+/**
+ * Serves tiles on {t_port} until interrupted, computed with the options of {t_defaults} and kept up to
+ * {t_cache_budget} bytes. {t_buffer}, {t_state} and {t_colorizer} are shared by all tiles. */
+static int serve_tiles(
+        const job_t *t_defaults, uint16_t t_port, size_t t_cache_budget, IterationBuffer *t_buffer,
+        IterationState *t_state, colorizer_t *t_colorizer, thread_pool_t *t_pool
+)
+{
+    tile_renderer_t renderer = {
+            .job = *t_defaults, .buffer = t_buffer, .state = t_state, .colorizer = t_colorizer, .pool = t_pool,
+    };
+    if (renderer.job.scheme.palette == PALETTE_HISTOGRAM) {
+        // the histogram differs between tiles, which would show at their edges
+        renderer.job.scheme.palette = PALETTE_CYCLIC;
+        nm_log(LOG_INFO, "tiles are colored with the cyclic palette instead of the histogram\n");
+    }
+    if (!samples_fit(TILE_SIZE, TILE_SIZE, renderer.job.samples_per_pixel)) {
+        nm_log(
+                LOG_ERROR, "a tile of %ux%u samples per pixel is more than %u samples\n",
+                renderer.job.samples_per_pixel, renderer.job.samples_per_pixel, UINT32_MAX
+        );
+        return EXIT_FAILURE;
+    }
+    pthread_mutex_init(&renderer.mutex, NULL);
+
+    tile_server_t *server = malloc(sizeof(tile_server_t));
+    if (server == NULL) {
+        nm_log(LOG_ERROR, "could not allocate memory for the tile server\n");
+        pthread_mutex_destroy(&renderer.mutex);
+
+        return EXIT_FAILURE;
+    }
+    if (create_tile_server(server, t_port, TILE_MAX_ZOOM, t_cache_budget, render_tile, &renderer) == EXIT_FAILURE) {
+        free(server);
+        pthread_mutex_destroy(&renderer.mutex);
+        return EXIT_FAILURE;
+    }
+    signal(SIGINT, handle_stop);
+    signal(SIGTERM, handle_stop);
+    tile_server_run(server, &stop_serving);
+
+    char stats[1024];
+    tile_server_stats(server, stats, sizeof(stats));
+    nm_log(LOG_INFO, "stopped serving tiles\n%s", stats);
+    delete_tile_server(server);
+    free(server);
+    pthread_mutex_destroy(&renderer.mutex);
+
+    return EXIT_SUCCESS;
+}
+
+int main(int argc, char **argv)
+{
+    // stdout is kept for the frames of a video
+    nm_log_stream(stderr);
+    nm_log_init(LOG_INFO, true);
+
+    /** collect the options that apply to the whole run, the others are the defaults of every job */
+    job_t defaults = {
+            .re_center = FRACTAL_START.re_center,
+            .im_center = FRACTAL_START.im_center,
+            .extent = fractal_re_size(FRACTAL_START),
+            .width = 1024,
+            .height = 768,
+            .max_iterations = 0,
+            .samples_per_pixel = 1,
+            .strip_height = 0,
+            .frame_count = 0,
+            .end_extent = 0.,
+            .scheme = {PALETTE_HISTOGRAM, 0.f, 1.f / 32.f},
+            .output = "",
+    };
+    const char *job_path = NULL;
+    uint32_t thread_count = 0;
+    uint32_t serve_port = 0;
+    uint32_t cache_megabytes = 256;
+    char **job_args = malloc(sizeof(char *) * argc);
+    if (job_args == NULL) {
+        nm_log(LOG_ERROR, "could not allocate memory for the options\n");
+        return EXIT_FAILURE;
+    }
+    int job_arg_count = 0;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--help") == 0 || strcmp(argv[i], "-h") == 0) {
+            fputs(USAGE, stdout);
+            free(job_args);
+            return EXIT_SUCCESS;
+        } else if (strcmp(argv[i], "--jobs") == 0 && i + 1 < argc) {
+            job_path = argv[++i];
+        } else if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc) {
+            if (parse_uint(argv[++i], &thread_count) == EXIT_FAILURE) {
+                nm_log(LOG_ERROR, "invalid number of threads '%s'\n", argv[i]);
+                free(job_args);
+                return EXIT_FAILURE;
+            }
+        } else if (strcmp(argv[i], "--serve") == 0 && i + 1 < argc) {
+            if (parse_uint(argv[++i], &serve_port) == EXIT_FAILURE || serve_port == 0 || serve_port > UINT16_MAX) {
+                nm_log(LOG_ERROR, "invalid port '%s'\n", argv[i]);
+                free(job_args);
+                return EXIT_FAILURE;
+            }
+        } else if (strcmp(argv[i], "--cache-mb") == 0 && i + 1 < argc) {
+            if (parse_uint(argv[++i], &cache_megabytes) == EXIT_FAILURE) {
+                nm_log(LOG_ERROR, "invalid cache size '%s'\n", argv[i]);
+                free(job_args);
+                return EXIT_FAILURE;
+            }
+        } else {
+            job_args[job_arg_count++] = argv[i];
+        }
+    }
+    int parsed = parse_job_options(&defaults, job_arg_count, job_args, "command line");
+    free(job_args);
+    if (parsed == EXIT_FAILURE) {
+        fputs(USAGE, stderr);
+        return EXIT_FAILURE;
+    }
+
+    init_mandelbrot();
+    set_adaptive_supersampling(true, ADAPTIVE_THRESHOLD);
+
+    thread_pool_t pool;
+    if (create_thread_pool(&pool, thread_count) == EXIT_FAILURE) {
+        nm_log(LOG_ERROR, "failed to create thread pool\n");
+        return EXIT_FAILURE;
+    }
+
+    // kept between jobs, so that their allocations are reused
+    IterationBuffer buffer = {0};
+    IterationState state;
+    create_iteration_state(&state);
+    colorizer_t colorizer;
+    create_colorizer(&colorizer);
+
+    int result;
+    if (serve_port > 0) {
+        result = serve_tiles(
+                &defaults, (uint16_t) serve_port, (size_t) cache_megabytes << 20, &buffer, &state, &colorizer, &pool
+        );
+    } else if (job_path != NULL) {
+        result = render_job_file(job_path, &defaults, &buffer, &state, &colorizer, &pool);
+    } else {
+        if (defaults.output[0] == '\0') strcpy(defaults.output, "mandelbrot.png");
+        result = render_job(&defaults, 0, &buffer, &state, &colorizer, &pool);
+    }
+
+    delete_colorizer(&colorizer);
+    delete_iteration_state(&state);
+    free(buffer.data);
+    delete_thread_pool(&pool);
+    nm_log_cleanup();
+
+    return result;
+}
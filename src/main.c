@@ -7,63 +7,78 @@
 #include <stdint.h>
 #include <inttypes.h>
 #include <stdlib.h>
-#include <time.h>
+#include <string.h>
 #include <pthread.h>
+#include <stdatomic.h>
 #include <stdbool.h>
+#include <math.h>
 #include <system/input.h>
 #include <system/window.h>
 #include <system/shader_manager.h>
 #include <util/util.h>
 #include <util/mandelbrot.h>
+#include <util/iteration_cache.h>
+#include <util/colorizer.h>
+#include <util/iteration_mailbox.h>
+#include <util/command_queue.h>
 
-const uint32_t INITIAL_MAX_ITER = 60;   // initial value of max_iterations
-const uint32_t ITER_STEP = 20;          // the value of which max_iterations is increased by, every step
-#define MAX_LEVELS 32                   // limit to the amount of times the fractal can be zoomed into
+#define MAX_LEVELS 256                  // limit to the amount of times the fractal can be zoomed into
 const float RESOLUTION = (4.0f / 3.0f); // resolution of the fractal defined by the FRACTAL_START coordinates
-const uint32_t SAMPLES_PER_PIXEL_X = 1;                   // number of samples per pixel in horizontal direction
-const uint32_t SAMPLES_PER_PIXEL_Y = SAMPLES_PER_PIXEL_X; // number of samples per pixel in horizontal direction
+const uint32_t SAMPLES_PER_PIXEL = 1;           // number of samples per pixel in both directions
+const uint32_t ANTIALIAS_SAMPLES_PER_PIXEL = 4; // number of samples per pixel in both directions when anti-aliasing
+const float ADAPTIVE_THRESHOLD = .5f;           // difference in iterations to a neighbour that refines a pixel
+const float PALETTE_OFFSET_STEP = 1.f / 16.f;   // fraction of the hue circle the palette is moved by, every step
+const size_t ITERATION_CACHE_BUDGET = (size_t) 512 << 20; // bytes the iteration states of other levels may take
 
-// state that is shared between the two threads
+// state of the view, owned by the compute thread and changed through commands from the main thread
 struct state {
+    // size of the view in pixels, zero while the window is iconified
+    uint32_t width;
+    uint32_t height;
+
     // limit to the number of iterations in the mandelbrot function
     uint32_t max_iterations;
+    // whether raising {max_iterations} no longer changes the view, so that there is nothing to compute
+    bool converged;
 
     // maintained stack of fractal coordindates, to go back once zoomed
     Fractal fractal_stack[MAX_LEVELS];
 
     // current position on stack
     uint32_t fractal_stack_pointer;
+
+    // number of samples per pixel in both directions, toggled between no anti-aliasing and adaptive anti-aliasing
+    uint32_t samples_per_pixel;
 };
 
+thread_pool_t m_pool; // workers that compute the tiles of a texture
 quad m_quad;        // quad that is used to render the fractal and selection on
-tex_t m_tex;        // texture for the fractal
+streamed_tex_t m_tex; // iteration counts of the fractal, colored by the iteration shader
+buffer_tex_t m_hue_tex; // histogram of the iteration counts of the fractal, for the histogram palette
 tex_t m_select_tex; // texture for the selection quad
-
-pthread_mutex_t state_mutex;          // protects {m_state}
-pthread_mutex_t window_mutex;         // protects {get_window_width} and {get_window_height}
-// synchronizing behavior between compute and main thread
-pthread_mutex_t computing_done_mutex; // protects {texture_local}
-pthread_cond_t computing_done_cv;
+colorizer_t m_colorizer; // keeps the iterations computed by the compute thread, and colors them for export
 
 /** accessed by main thread only */
 double clicked_xpos, clicked_ypos; // position of the mouse when selection started
 bool selecting = false;            // whether something is being selected
+uint32_t known_width, known_height; // window size the last resize check was done for
+// number of samples per pixel in both directions the compute thread was last told to use
+uint32_t samples_per_pixel = SAMPLES_PER_PIXEL;
+// color scheme the iterations are colored with, changing it only colors the iterations again
+color_scheme_t m_scheme = {PALETTE_HISTOGRAM, 0.f, 1.f / 32.f};
+// tiles of {m_tex} that are outdated, taken from the tile versions of the iterations until they are uploaded
+bool *m_dirty_tiles = NULL;
+uint32_t m_dirty_tile_count = 0;
+uint32_t m_taken_sequence = 0; // sequence number of the last iterations taken from {m_mailbox}
 
 /** accessed by both threads */
-volatile bool done = false;           // program state for stopping the compute thread
-volatile bool computing_done = false; // whether compute thread is done computing, and render thread may swap textures
-volatile struct state m_state;        // variables related to which texture needs to be rendered
-volatile Texture texture_local;       // current texture
+command_queue_t m_commands;    // changes to the view, sent by the main thread and applied by the compute thread
+iteration_mailbox_t m_mailbox; // iterations of the current view, written by the compute thread
 
 void create_selection_matrix(mat4x4 p_selection_matrix)
 {
-    uint32_t w, h;
-    pthread_mutex_lock(&window_mutex);
-    {
-        w = get_window_width();
-        h = get_window_height();
-    }
-    pthread_mutex_unlock(&window_mutex);
+    uint32_t w = get_window_width();
+    uint32_t h = get_window_height();
     float selected_size_width = (float) (xpos - clicked_xpos);
     // height is scaled from horizontal positions to maintain window aspect ratio
     float selected_size_height = (selected_size_width / (float) w) * h;
@@ -93,96 +108,312 @@ void create_selection_matrix(mat4x4 p_selection_matrix)
     mat4x4_mul(p_selection_matrix, p_selection_matrix, scale);
 }
 
-// compute thread function, non-preemptive
-void *compute_function(void *vargp)
+/**
+ * Hands {t_buffer} to the main thread without waiting for it, and returns the buffer to continue in.
+ * Called by the compute thread. */
+volatile IterationBuffer *publish_iterations(volatile IterationBuffer *t_buffer, void *t_arg)
 {
-    while (1) {
-        // if program is done, stop this thread
-        if (done) break;
-
-        // obtain data mutex and compute next texture
-        pthread_mutex_lock(&computing_done_mutex);
-        {
-            /** obtain width and height */
-            uint32_t w, h;
-            pthread_mutex_lock(&window_mutex);
-            {
-                w = get_window_width();
-                h = get_window_height();
-            }
-            pthread_mutex_unlock(&window_mutex);
+    IterationBuffer *next = iteration_mailbox_publish(&m_mailbox);
+    wake_window();
 
-            /** update state if expected size does not match with obtained size */
-            if (texture_local.width != w || texture_local.height != h) {
-                texture_local.width = w;
-                texture_local.height = h;
+    return next;
+}
 
-                // change the size of the allocated buffer
-                uint8_t *new_data = realloc(
-                        texture_local.data, sizeof(uint8_t) * texture_local.width * texture_local.height * 4
-                );
-                if (new_data) {
-                    texture_local.data = new_data;
-                } else {
-                    // todo: exit thread due to fatal error, could not reallocate memory
-                    nm_log(LOG_ERROR, "cannot reallocate memory\n");
-                }
+/**
+ * Adds the tiles of {t_buffer} that changed since the last taken iterations to the outdated tiles of {m_tex}.
+ * Returns {EXIT_FAILURE} if the outdated tiles could not be resized, in which case they are left as is.
+ * Called by the main thread. */
+int take_dirty_tiles(const IterationBuffer *t_buffer)
+{
+    uint32_t count = iteration_tile_count(t_buffer->width) * iteration_tile_count(t_buffer->height);
+    if (m_dirty_tile_count != count) {
+        // the size changed, which replaces the texture and uploads it entirely
+        bool *dirty_tiles = realloc(m_dirty_tiles, sizeof(bool) * count);
+        if (dirty_tiles == NULL) {
+            nm_log(LOG_ERROR, "could not allocate memory for %u outdated tiles\n", count);
+
+            return EXIT_FAILURE;
+        }
+        m_dirty_tiles = dirty_tiles;
+        m_dirty_tile_count = count;
+        memset(m_dirty_tiles, true, sizeof(bool) * count);
+    }
+
+    // the versions include the changes of iterations that were published but skipped
+    for (uint32_t i = 0; i < count; i++) {
+        m_dirty_tiles[i] |= t_buffer->tile_versions[i] > m_taken_sequence;
+    }
+    m_taken_sequence = t_buffer->sequence;
+
+    return EXIT_SUCCESS;
+}
+
+/**
+ * Uploads the outdated tiles of the iterations of {m_colorizer} into {m_tex}, or all of them into a new texture
+ * if the size changed. Runs of outdated tiles in a row of tiles are uploaded as a single rectangle. */
+void upload_iterations()
+{
+    uint32_t w = m_colorizer.m_width;
+    uint32_t h = m_colorizer.m_height;
+    uint32_t tiles_x = iteration_tile_count(w);
+    uint32_t tiles_y = iteration_tile_count(h);
+
+    if (m_tex.m_width != w || m_tex.m_height != h) {
+        delete_streamed_tex(&m_tex);
+        create_streamed_tex(&m_tex, GL_TEXTURE0, w, h);
+        memset(m_dirty_tiles, true, sizeof(bool) * tiles_x * tiles_y);
+    }
+
+    /** collect the rectangles to upload */
+    tex_rect_t *rects = malloc(sizeof(tex_rect_t) * tiles_x * tiles_y);
+    if (rects == NULL) {
+        // the tiles stay outdated and are uploaded with the next iterations
+        nm_log(LOG_ERROR, "could not allocate memory for %ux%u rectangles to upload\n", tiles_x, tiles_y);
+        return;
+    }
+    uint32_t rect_count = 0;
+    uint32_t texel_count = 0;
+    for (uint32_t ty = 0; ty < tiles_y; ty++) {
+        for (uint32_t tx = 0; tx < tiles_x; tx++) {
+            if (!m_dirty_tiles[ty * tiles_x + tx]) continue;
+
+            uint32_t x = tx * ITERATION_TILE_SIZE;
+            uint32_t y = ty * ITERATION_TILE_SIZE;
+            uint32_t tile_w = x + ITERATION_TILE_SIZE < w ? ITERATION_TILE_SIZE : w - x;
+            uint32_t tile_h = y + ITERATION_TILE_SIZE < h ? ITERATION_TILE_SIZE : h - y;
+
+            if (rect_count > 0 && rects[rect_count - 1].m_y == y &&
+                rects[rect_count - 1].m_x + rects[rect_count - 1].m_width == x) {
+                rects[rect_count - 1].m_width += tile_w;
+            } else {
+                rects[rect_count++] = (tex_rect_t) {x, y, tile_w, tile_h};
+            }
+            texel_count += tile_w * tile_h;
+        }
+    }
 
-                pthread_mutex_lock(&state_mutex);
-                {
-                    // reset max iterations
-                    m_state.max_iterations = INITIAL_MAX_ITER;
-
-                    // clear the stack and reset pointer
-                    m_state.fractal_stack_pointer = 0;
-
-                    // set the start coordinates based on new resolution
-                    m_state.fractal_stack[0] = FRACTAL_START;
-                    float new_res = w / (float) h;
-                    if (new_res < RESOLUTION) { // new height is larger, so scale height parameters up
-                        m_state.fractal_stack[0].im_start *= (RESOLUTION / new_res);
-                        m_state.fractal_stack[0].im_end *= (RESOLUTION / new_res);
-                    } else if (new_res > RESOLUTION) { // new width is larger, so scale width parameters up
-                        m_state.fractal_stack[0].re_start *= (new_res / RESOLUTION);
-                        m_state.fractal_stack[0].re_end *= (new_res / RESOLUTION);
-                    } else {
-                        // resolution is exactly the same, and FRACTAL_START is appropriate
-                    }
+    /** copy the rectangles one after another into the next pixel buffer, from which they are transferred */
+    if (rect_count > 0) {
+        float *mapped = map_streamed_tex(&m_tex, texel_count);
+        if (mapped != NULL) {
+            for (uint32_t i = 0; i < rect_count; i++) {
+                for (uint32_t y = rects[i].m_y; y < rects[i].m_y + rects[i].m_height; y++) {
+                    memcpy(mapped, &m_colorizer.m_iterations[y * w + rects[i].m_x], sizeof(float) * rects[i].m_width);
+                    mapped += rects[i].m_width;
                 }
-                pthread_mutex_unlock(&state_mutex);
             }
 
-            nm_log(LOG_TRACE, "starting to compute for size=%ux%u\n", texture_local.width, texture_local.height);
-
-            uint32_t maxiter, depth;
-            Fractal fractal;
-            /** obtain the state mutex and copy the values needed to compute the next texture */
-            pthread_mutex_lock(&state_mutex);
-            {
-                depth = m_state.fractal_stack_pointer;
-                fractal = m_state.fractal_stack[m_state.fractal_stack_pointer];
-                maxiter = m_state.max_iterations;
-                m_state.max_iterations += ITER_STEP;
+            // on failure the tiles stay outdated and are uploaded with the next iterations
+            if (unmap_streamed_tex(&m_tex, rects, rect_count) == EXIT_SUCCESS) {
+                memset(m_dirty_tiles, false, sizeof(bool) * tiles_x * tiles_y);
+            }
+        }
+        nm_log(LOG_TRACE, "uploaded %u of %u texels in %u rectangles\n", texel_count, w * h, rect_count);
+    }
+    free(rects);
+}
+
+/**
+ * Applies {t_command} to {t_state}, a command that changes the view resets the maximum number of iterations.
+ * Called by the compute thread, for any command but {COMMAND_QUIT}. */
+void apply_command(struct state *t_state, const command_t *t_command)
+{
+    // computing starts again, if only to find that the view did not change
+    t_state->converged = false;
+
+    switch (t_command->m_type) {
+        case COMMAND_ZOOM_IN: {
+            Fractal curr_fractal = t_state->fractal_stack[t_state->fractal_stack_pointer];
+            double spacing = fabs(fractal_re_size(curr_fractal)) / t_state->width;
+            if (t_state->fractal_stack_pointer == MAX_LEVELS - 1 || spacing < MIN_SPACING) {
+                fprintf(stdout, "maximum depth reached!\n");
+                break;
+            }
+
+            // add to next position on stack
+            t_state->fractal_stack[++t_state->fractal_stack_pointer] = zoom_fractal(
+                    curr_fractal, t_command->m_zoom.m_re_offset, t_command->m_zoom.m_im_offset,
+                    t_command->m_zoom.m_re_factor, t_command->m_zoom.m_im_factor
+            );
+            t_state->max_iterations = INITIAL_MAX_ITER;
+            break;
+        }
+        case COMMAND_ZOOM_OUT:
+            if (t_state->fractal_stack_pointer == 0) {
+                fprintf(stdout, "cannot go back!\n");
+            } else {
+                t_state->fractal_stack_pointer--;
+                t_state->max_iterations = INITIAL_MAX_ITER;
+            }
+            break;
+        case COMMAND_RESIZE: {
+            uint32_t w = t_command->m_size.m_width;
+            uint32_t h = t_command->m_size.m_height;
+            // a burst of resizes may end at the size it started from
+            if (w == t_state->width && h == t_state->height) break;
+            t_state->width = w;
+            t_state->height = h;
+            // an iconified window may have a size of 0x0, the view is set once it is restored
+            if (w == 0 || h == 0) break;
+
+            // reset max iterations
+            t_state->max_iterations = INITIAL_MAX_ITER;
+
+            // clear the stack and reset pointer
+            t_state->fractal_stack_pointer = 0;
+
+            // set the start coordinates based on new resolution
+            t_state->fractal_stack[0] = FRACTAL_START;
+            float new_res = w / (float) h;
+            if (new_res < RESOLUTION) { // new height is larger, so scale height parameters up
+                t_state->fractal_stack[0].im_size *= (RESOLUTION / new_res);
+            } else if (new_res > RESOLUTION) { // new width is larger, so scale width parameters up
+                t_state->fractal_stack[0].re_size *= (new_res / RESOLUTION);
+            } else {
+                // resolution is exactly the same, and FRACTAL_START is appropriate
+            }
+            break;
+        }
+        case COMMAND_SET_SAMPLES:
+            t_state->samples_per_pixel = t_command->m_samples_per_pixel;
+            nm_log(
+                    LOG_TRACE, "samples per pixel set to %ux%u\n", t_state->samples_per_pixel,
+                    t_state->samples_per_pixel
+            );
+            t_state->max_iterations = INITIAL_MAX_ITER;
+            break;
+        case COMMAND_QUIT:
+            break;
+    }
+}
+
+// compute thread function, non-preemptive
+void *compute_function(void *vargp)
+{
+    // the view to compute, only changed by the commands of the main thread
+    struct state state;
+    state.width = 0;
+    state.height = 0;
+    state.max_iterations = INITIAL_MAX_ITER;
+    state.converged = false;
+    state.fractal_stack_pointer = 0;
+    state.fractal_stack[state.fractal_stack_pointer] = FRACTAL_START;
+    state.samples_per_pixel = SAMPLES_PER_PIXEL;
+
+    // commands taken from {m_commands}
+    command_t *commands = NULL;
+    uint32_t command_capacity = 0;
+
+    // iteration state of the last computed view, continued if the view did not change
+    IterationState iteration_state;
+    create_iteration_state(&iteration_state);
+    uint32_t state_depth = 0; // level of the stack {iteration_state} belongs to
+
+    // iteration states of the other levels of the stack, to resume them when zooming out
+    iteration_cache_t iteration_cache;
+    create_iteration_cache(&iteration_cache, ITERATION_CACHE_BUDGET);
+
+    bool quit = false;
+    while (!quit) {
+        /** apply all commands sent since the last pass, so that a burst of them is computed only once */
+        // without a size or once converged there is nothing to compute, so wait for the next command
+        bool idle = state.width == 0 || state.height == 0 || state.converged;
+        uint32_t count = command_queue_take(&m_commands, &commands, &command_capacity, idle);
+        for (uint32_t i = 0; i < count && !quit; i++) {
+            if (commands[i].m_type == COMMAND_QUIT) {
+                quit = true;
+            } else {
+                apply_command(&state, &commands[i]);
+            }
+        }
+        if (quit || state.width == 0 || state.height == 0) continue;
+
+        /** update the buffer if its size does not match the size of the view */
+        IterationBuffer *buffer = iteration_mailbox_back(&m_mailbox);
+        if (buffer->width != state.width || buffer->height != state.height) {
+            // change the size of the buffer, which marks all its tiles as changed
+            if (iteration_mailbox_resize(&m_mailbox, state.width, state.height) == EXIT_FAILURE) {
+                // wait for the next command to try again
+                state.converged = true;
+                continue;
             }
-            pthread_mutex_unlock(&state_mutex);
 
-            nm_log(LOG_TRACE, "copied fractal info for max_iter=%u, depth=%u\n", maxiter, depth);
+            // the stack is cleared, and neither the cached states nor the current one match the size
+            iteration_cache_clear(&iteration_cache);
+            delete_iteration_state(&iteration_state);
+            create_iteration_state(&iteration_state);
+        }
+
+        nm_log(LOG_TRACE, "starting to compute for size=%ux%u\n", state.width, state.height);
 
-            generate(&texture_local, fractal, maxiter, SAMPLES_PER_PIXEL_X, SAMPLES_PER_PIXEL_Y);
+        uint32_t depth = state.fractal_stack_pointer;
+        Fractal fractal = state.fractal_stack[state.fractal_stack_pointer];
+        uint32_t maxiter = state.max_iterations;
+        uint32_t spp = state.samples_per_pixel;
+        bool resumed = false;
 
-            computing_done = true; // tell main thread that texture has been completed
+        nm_log(LOG_TRACE, "copied fractal info for max_iter=%u, depth=%u\n", maxiter, depth);
 
-            // wait until main thread has recreated texture pipeline
-            pthread_cond_wait(&computing_done_cv, &computing_done_mutex);
+        /** on a change of view, keep the state of the previous view and pick up a cached one */
+        if (!fractal_equal(iteration_state.fractal, fractal) || iteration_state.spp_x != spp) {
+            // a cancelled state starts over anyway
+            if (iteration_state.sample_count > 0 && !iteration_state.cancelled) {
+                iteration_cache_store(&iteration_cache, state_depth, &iteration_state);
+            } else {
+                delete_iteration_state(&iteration_state);
+                create_iteration_state(&iteration_state);
+            }
+            state_depth = depth;
+
+            if (iteration_cache_take(&iteration_cache, depth, fractal, &iteration_state) &&
+                iteration_state.spp_x == spp && iteration_state.max_iterations > maxiter) {
+                nm_log(LOG_TRACE, "resuming depth=%u from max_iter=%u\n", depth, iteration_state.max_iterations);
+                // the first pass only colors the cached samples, later passes continue from there
+                maxiter = iteration_state.max_iterations;
+                resumed = true;
+            }
+        }
+
+        // a new view is published at coarser levels first, so that zooming shows a result right away
+        // a command sent during the pass abandons it, the next pass applies the command first
+        bool complete = generate(
+                buffer, &iteration_state, fractal, maxiter, spp, spp, &m_pool, publish_iterations, NULL,
+                &m_commands.m_pending
+        ) == EXIT_SUCCESS;
+
+        if (complete) {
+            // the main thread takes the newest iterations whenever it is ready, the next pass starts right away
+            publish_iterations(buffer, NULL);
+
+            /** raise the maximum while that still lets a meaningful part of the samples escape */
+            // a resumed pass iterates nothing, so it says nothing about convergence
+            if (!resumed && iteration_state_converged(&iteration_state)) {
+                state.converged = true;
+                nm_log(
+                        LOG_INFO, "converged at max_iter=%u with %u samples escaped in the last pass, idle\n",
+                        maxiter, iteration_state.escaped
+                );
+            } else {
+                state.max_iterations = next_max_iterations(maxiter);
+            }
+        } else if (atomic_load(&m_commands.m_pending)) {
+            nm_log(LOG_TRACE, "cancelled computing for max_iter=%u, depth=%u\n", maxiter, depth);
+        } else {
+            // wait for the next command to try again
+            nm_log(LOG_ERROR, "failed to compute for max_iter=%u, depth=%u\n", maxiter, depth);
+            state.converged = true;
         }
-        pthread_mutex_unlock(&computing_done_mutex);
     }
 
+    delete_iteration_cache(&iteration_cache);
+    delete_iteration_state(&iteration_state);
+    free(commands);
+
     return NULL;
 }
 
-/** Updates the state of the program by using the input handler. */
-void update();
+/** Updates the state of the program by using the input handler, returns whether the frame needs to be drawn. */
+bool update();
 
 /** Renders both quads. */
 void render();
@@ -191,6 +422,9 @@ int main(int argc, char **argv)
 {
     nm_log_init(LOG_TRACE, true);
 
+    init_mandelbrot();
+    set_adaptive_supersampling(true, ADAPTIVE_THRESHOLD);
+
     init_input();
 
     if (init_window(true) == EXIT_FAILURE) {
@@ -206,50 +440,57 @@ int main(int argc, char **argv)
     uint8_t select_pixel[] = {51, 153, 255, 100};
     create_tex_from_mem(&m_select_tex, GL_TEXTURE0, select_pixel, 1, 1, 4);
 
+    // create the hue texture once, its data is replaced with every new iteration buffer
+    const float hue = 0.f;
+    create_buffer_tex_from_mem(&m_hue_tex, GL_TEXTURE1, &hue, 1);
+
     // thread handle for the compute thread
     pthread_t compute_thread;
 
-    // set up state variables
-    m_state.max_iterations = INITIAL_MAX_ITER;
-    m_state.fractal_stack_pointer = 0;
-    m_state.fractal_stack[m_state.fractal_stack_pointer] = FRACTAL_START;
+    // the compute thread starts with the size of the window
+    if (create_command_queue(&m_commands) == EXIT_FAILURE) {
+        nm_log(LOG_ERROR, "failed to create command queue\n");
+        return EXIT_FAILURE;
+    }
+    known_width = get_window_width();
+    known_height = get_window_height();
+    command_queue_push(&m_commands, (command_t) {COMMAND_RESIZE, .m_size = {known_width, known_height}});
 
-    // initialize synchronization variables
-    pthread_mutex_init(&state_mutex, NULL);
-    pthread_mutex_init(&window_mutex, NULL);
-    pthread_mutex_init(&computing_done_mutex, NULL);
-    pthread_cond_init(&computing_done_cv, NULL);
+    // allocate iterations, the texture is allocated once the first iterations are taken
+    if (create_iteration_mailbox(&m_mailbox, get_window_width(), get_window_height()) == EXIT_FAILURE) {
+        nm_log(LOG_ERROR, "failed to create iteration mailbox\n");
+        return EXIT_FAILURE;
+    }
+    create_colorizer(&m_colorizer);
 
-    // allocate texture
-    texture_local.width = get_window_width();
-    texture_local.height = get_window_height();
-    texture_local.data = malloc(sizeof(uint8_t) * get_window_width() * get_window_height() * 4);
+    // create the workers, one per processor
+    if (create_thread_pool(&m_pool, 0) == EXIT_FAILURE) {
+        nm_log(LOG_ERROR, "failed to create thread pool\n");
+        return EXIT_FAILURE;
+    }
 
     // create the compute thread
     pthread_create(&compute_thread, NULL, compute_function, NULL);
 
-    // initialize tick buffer for title
+    // initialize tick buffer for title, counting the frames drawn in the last second
     circular_tick_buffer_t tick_buffer;
-    create_tick_buffer(&tick_buffer, 512, CLOCKS_PER_SEC);
+    create_tick_buffer(&tick_buffer, 512, 1.);
 
-    // main loop
+    // main loop, which only draws a frame when something changed and otherwise sleeps until the next event
     char title[256];
     while (!window_should_close()) {
-        // process events; fill input handler (through glfw callbacks)
-        pthread_mutex_lock(&window_mutex);
-        {
-            pull_input();
-        }
-        pthread_mutex_unlock(&window_mutex);
+        // wait for and process events; fill input handler (through glfw callbacks)
+        // the compute thread wakes the wait when it publishes iterations
+        pull_input(true);
 
-        update();
+        if (!update()) continue;
 
         render();
 
         // update window title
         // todo this block should move somewhere else (some kind of debug class?)
-        tick_buffer_add(&tick_buffer, clock());
-        snprintf(title, 255, "fps: %" PRId64, tick_buffer_query(&tick_buffer, clock()));
+        tick_buffer_add(&tick_buffer, get_window_time());
+        snprintf(title, 255, "fps: %" PRId64, tick_buffer_query(&tick_buffer, get_window_time()));
         set_window_title(title);
 
         // swap buffers
@@ -257,32 +498,22 @@ int main(int argc, char **argv)
     }
     delete_tick_buffer(&tick_buffer);
 
-    // already cleanup window
-    cleanup_window();
-
-    // set status to done to signal compute thread to stop
-    done = true;
-
-    // signal compute thread to it stops waiting
-    pthread_mutex_lock(&computing_done_mutex);
-    {
-        pthread_cond_signal(&computing_done_cv);
-    }
-    pthread_mutex_unlock(&computing_done_mutex);
+    // signal compute thread to stop, which abandons the pass it is computing
+    command_queue_push(&m_commands, (command_t) {COMMAND_QUIT});
 
-    // destroy all mutices
-    pthread_mutex_destroy(&computing_done_mutex);
-    pthread_mutex_destroy(&state_mutex);
-    pthread_mutex_destroy(&window_mutex);
+    // join the compute thread, before the queue it uses is deleted and the window it wakes is cleaned up
+    pthread_join(compute_thread, NULL);
+    delete_command_queue(&m_commands);
 
-    // destroy all condition variables
-    pthread_cond_destroy(&computing_done_cv);
+    cleanup_window();
 
-    // join the compute thread
-    pthread_join(compute_thread, NULL);
+    // stop the workers, after the compute thread no longer uses them
+    delete_thread_pool(&m_pool);
 
     // free allocated memory
-    free(texture_local.data);
+    delete_iteration_mailbox(&m_mailbox);
+    free(m_dirty_tiles);
+    delete_colorizer(&m_colorizer);
 
     cleanup_shader_manager();
     delete_quad(&m_quad);
@@ -298,7 +529,10 @@ void render()
     mat4x4 identity;
     mat4x4_identity(identity);
     mat4x4_scale_aniso(identity, identity, 1.f, -1.f, 1.f);
-    render_ortho_tex_quad(&m_quad, &m_tex, identity);
+    render_iteration_quad(
+            &m_quad, &m_tex.m_tex, &m_hue_tex, (float) m_colorizer.m_max_iterations, m_scheme.palette, m_scheme.offset,
+            m_scheme.cycle_speed, identity
+    );
 
     // draw the selection quad (if selecting)
     if (selecting) {
@@ -308,39 +542,85 @@ void render()
     }
 }
 
-void update()
+bool update()
 {
-    /** replace texture */
-    // if computing is done, to apply computed texture to window
-    // only when perform this work when the window is not iconified to prevent computing for size 0x0
-    if (computing_done && !is_iconified()) {
-        pthread_mutex_lock(&computing_done_mutex);
-        {
-            // replace the texture for the computed one
-            delete_tex(&m_tex);
-            create_tex_from_mem(&m_tex, GL_TEXTURE0, texture_local.data, texture_local.width, texture_local.height, 4);
-
-            // signal compute thread that pipeline has been recreated
-            pthread_cond_signal(&computing_done_cv);
-            computing_done = false;
+    // whether anything that is drawn changed
+    bool redraw = is_damaged() || is_resized();
+
+    /** a resize abandons the pass in progress, the compute thread starts over for the new size */
+    if (get_window_width() != known_width || get_window_height() != known_height) {
+        known_width = get_window_width();
+        known_height = get_window_height();
+        if (command_queue_push(&m_commands, (command_t) {COMMAND_RESIZE, .m_size = {known_width, known_height}}) ==
+            EXIT_FAILURE) {
+            // sent again with the next update
+            known_width = 0;
+            known_height = 0;
         }
-        pthread_mutex_unlock(&computing_done_mutex);
+    }
+
+    /** take the iterations */
+    // take the newest iterations if there are new ones, the compute thread does not wait for this
+    // only when perform this work when the window is not iconified to prevent uploading for size 0x0
+    const IterationBuffer *iterations = is_iconified() ? NULL : iteration_mailbox_take(&m_mailbox);
+    // iterations that could not be kept are skipped, their changed tiles are taken along with the next ones
+    if (iterations != NULL && colorizer_set_iterations(
+            &m_colorizer, iterations->data, iterations->width, iterations->height, iterations->max_iterations
+    ) == EXIT_SUCCESS && take_dirty_tiles(iterations) == EXIT_SUCCESS) {
+        // update the textures in place, the iteration shader colors them
+        upload_iterations();
+        update_buffer_tex(&m_hue_tex, m_colorizer.m_hues, m_colorizer.m_max_iterations + 1);
+        redraw = true;
     }
 
     /** update state from input*/
-    // p dumps the texture to file
-    if (get_key_state(KEY_P, PRESSED)) {
-        // protects {texture_local}
-        pthread_mutex_lock(&computing_done_mutex);
-        {
-            nm_log(LOG_TRACE, "dumping texture to file\n");
-            const uint32_t channels = 4;
+    // p colors the iterations on the cpu and writes them to file
+    if (get_key_state(KEY_P, PRESSED) && m_colorizer.m_iterations != NULL) {
+        nm_log(LOG_TRACE, "dumping texture to file\n");
+        const uint32_t channels = 4;
+        uint8_t *pixels = malloc(sizeof(uint8_t) * m_colorizer.m_width * m_colorizer.m_height * channels);
+        if (pixels == NULL) {
+            nm_log(LOG_ERROR, "could not allocate memory for the pixels of mandelbrot.png\n");
+        } else if (colorizer_apply(&m_colorizer, m_scheme, pixels) == EXIT_SUCCESS) {
             stbi_write_png(
-                    "mandelbrot.png", texture_local.width, texture_local.height, channels, texture_local.data,
-                    (int32_t) (texture_local.width * channels)
+                    "mandelbrot.png", m_colorizer.m_width, m_colorizer.m_height, channels, pixels,
+                    (int32_t) (m_colorizer.m_width * channels)
             );
         }
-        pthread_mutex_unlock(&computing_done_mutex);
+        free(pixels);
+    }
+
+    /** the color scheme is applied when rendering, so changing it does not require new iterations */
+    // c switches to the next palette
+    if (get_key_state(KEY_C, PRESSED)) {
+        m_scheme.palette = (m_scheme.palette + 1) % PALETTE_COUNT;
+        nm_log(LOG_TRACE, "palette set to %s\n", PALETTE_NAMES[m_scheme.palette]);
+        redraw = true;
+    }
+
+    // o moves the palette along the hue circle
+    if (get_key_state(KEY_O, PRESSED)) {
+        m_scheme.offset = fmodf(m_scheme.offset + PALETTE_OFFSET_STEP, 1.f);
+        redraw = true;
+    }
+
+    // minus and equals slow down and speed up the cyclic palette
+    if (get_key_state(KEY_MINUS, PRESSED)) {
+        m_scheme.cycle_speed /= 2.f;
+        redraw = true;
+    }
+    if (get_key_state(KEY_EQUAL, PRESSED)) {
+        m_scheme.cycle_speed *= 2.f;
+        redraw = true;
+    }
+
+    // a toggles anti-aliasing, which starts the view over at the initial maximum
+    if (get_key_state(KEY_A, PRESSED)) {
+        uint32_t spp = samples_per_pixel == SAMPLES_PER_PIXEL ? ANTIALIAS_SAMPLES_PER_PIXEL : SAMPLES_PER_PIXEL;
+        if (command_queue_push(&m_commands, (command_t) {COMMAND_SET_SAMPLES, .m_samples_per_pixel = spp}) ==
+            EXIT_SUCCESS) {
+            samples_per_pixel = spp;
+        }
     }
 
     // escape closes the window
@@ -351,68 +631,37 @@ void update()
     // backspace zooms out
     if (get_key_state(BACKSPACE, RELEASED)) {
         nm_log(LOG_TRACE, "zooming out\n");
-        pthread_mutex_lock(&state_mutex);
-        {
-            if (m_state.fractal_stack_pointer == 0) {
-                fprintf(stdout, "cannot go back!\n");
-            } else {
-                m_state.fractal_stack_pointer--;
-                m_state.max_iterations = INITIAL_MAX_ITER;
-            }
-        }
-        pthread_mutex_unlock(&state_mutex);
+        command_queue_push(&m_commands, (command_t) {COMMAND_ZOOM_OUT});
     }
 
     if (selecting) {
+        // the selection follows the cursor, and disappears once it is cancelled or confirmed
+        redraw |= get_offset_xpos() != 0 || get_offset_ypos() != 0;
+
         if (is_right_pressed()) {
             // cancel selection (were selecting, right mouse button is pressed)
             nm_log(LOG_TRACE, "cancelled selection\n");
             selecting = false;
+            redraw = true;
         } else if (is_left_released()) {
             // confirm selection (were selecting, left mouse button is released)
             nm_log(LOG_TRACE, "confirmed selection\n");
-            pthread_mutex_lock(&state_mutex);
-            {
-                if (m_state.fractal_stack_pointer == MAX_LEVELS - 1) {
-                    fprintf(stdout, "maximum depth reached!\n");
-                } else {
-                    if (selecting) { // to allow for canceling selection
-                        uint32_t w, h;
-                        pthread_mutex_lock(&window_mutex);
-                        {
-                            w = get_window_width();
-                            h = get_window_height();
-                        }
-                        pthread_mutex_unlock(&window_mutex);
-
-                        // obtain new ypos based on aspect ratio rather than real ypos
-                        float ypos_scaled =
-                                (float) clicked_ypos + ((float) (xpos - clicked_xpos) / w) * h;
-
-                        volatile Fractal *curr_fractal = &m_state.fractal_stack[m_state.fractal_stack_pointer];
-
-                        double re_size = curr_fractal->re_end - curr_fractal->re_start;
-                        double im_size = curr_fractal->im_end - curr_fractal->im_start;
-
-                        // new fractal definition
-                        Fractal next_fractal = {
-                                .re_start = curr_fractal->re_start + (clicked_xpos / w) * re_size,
-                                .re_end =curr_fractal->re_end - ((w - xpos) / w) * re_size,
-                                .im_start =curr_fractal->im_start + (clicked_ypos / h) * im_size,
-                                .im_end = curr_fractal->im_end - ((h - ypos_scaled) / h) * im_size,
-                        };
-
-                        // add to next position on stack
-                        m_state.fractal_stack[++m_state.fractal_stack_pointer] = next_fractal;
-
-                        // reset the max iterations
-                        m_state.max_iterations = INITIAL_MAX_ITER;
-                    }
-                }
-            }
-            pthread_mutex_unlock(&state_mutex);
+            uint32_t w = get_window_width();
+            uint32_t h = get_window_height();
+
+            // obtain new ypos based on aspect ratio rather than real ypos
+            float ypos_scaled = (float) clicked_ypos + ((float) (xpos - clicked_xpos) / w) * h;
+
+            // offset of the new center to the current center, and the new size, as fractions of the current size
+            command_t zoom = {COMMAND_ZOOM_IN};
+            zoom.m_zoom.m_re_offset = (clicked_xpos + xpos) / (2 * w) - .5;
+            zoom.m_zoom.m_im_offset = (clicked_ypos + ypos_scaled) / (2 * h) - .5;
+            zoom.m_zoom.m_re_factor = (xpos - clicked_xpos) / w;
+            zoom.m_zoom.m_im_factor = (ypos_scaled - clicked_ypos) / h;
+            command_queue_push(&m_commands, zoom);
 
             selecting = false;
+            redraw = true;
         }
     } else { // if (!selecting)
         if (is_left_pressed()) {
@@ -422,20 +671,15 @@ void update()
             clicked_ypos = get_ypos();
 
             selecting = true;
+            redraw = true;
         }
     }
 
     // update state
     if (is_resized()) {
         nm_log(LOG_TRACE, "resized\n");
-        uint32_t w, h;
-        pthread_mutex_lock(&window_mutex);
-        {
-            w = get_window_width();
-            h = get_window_height();
-        }
-        pthread_mutex_unlock(&window_mutex);
-
-        glViewport(0, 0, w, h);
+        glViewport(0, 0, get_window_width(), get_window_height());
     }
+
+    return redraw;
 }
\ No newline at end of file
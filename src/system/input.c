@@ -22,6 +22,7 @@ int init_input()
     m_right_released = false;
 
     m_resized = false;
+    m_damaged = false;
 
     return EXIT_SUCCESS;
 }
@@ -33,7 +34,7 @@ void cleanup_input()
     free(m_pressed);
 }
 
-int pull_input()
+int pull_input(bool p_wait)
 {
     /** reset inputs of which the callback is not triggered every event poll call */
     xoffset = 0;
@@ -54,8 +55,13 @@ int pull_input()
     memset(m_released, 0, sizeof(uint32_t) * VECTOR_COUNT);
 
     m_resized = false;
+    m_damaged = false;
 
-    glfwPollEvents();
+    if (p_wait) {
+        glfwWaitEvents();
+    } else {
+        glfwPollEvents();
+    }
 
     return EXIT_SUCCESS;
 }
@@ -222,11 +228,21 @@ void set_iconified(bool p_iconified)
     m_iconified = p_iconified;
 }
 
+void set_damaged(bool p_damaged)
+{
+    m_damaged = p_damaged;
+}
+
 bool is_resized()
 {
     return m_resized;
 }
 
+bool is_damaged()
+{
+    return m_damaged;
+}
+
 bool is_iconified()
 {
     return m_iconified;
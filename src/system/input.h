@@ -9,7 +9,10 @@ int init_input();
 
 void cleanup_input();
 
-int pull_input();
+/**
+ * Processes the events since the last call, after waiting for at least one if {p_wait}. Any thread can end
+ * the wait with {wake_window}. */
+int pull_input(bool p_wait);
 
 /** scroll offset */
 // the offset produced by scrolling
@@ -78,14 +81,19 @@ double get_offset_xpos();
 double get_offset_ypos();
 
 /** keyboard */
-#define KEY_COUNT 3      // number of key values defined in {key_value_t}
+#define KEY_COUNT 8      // number of key values defined in {key_value_t}
 #define BITS_PER_MASK 32 // number of bits per vectors {m_pressed, m_released, m_down}
 // number of vectors are needed to maintain all key values
 #define VECTOR_COUNT (KEY_COUNT / BITS_PER_MASK + ((KEY_COUNT % BITS_PER_MASK) ? 1 : 0))
 typedef enum {
     BACKSPACE = 0,
     ESCAPE,
-    KEY_P
+    KEY_P,
+    KEY_A,
+    KEY_C,
+    KEY_O,
+    KEY_MINUS,
+    KEY_EQUAL
     // NB: update {KEY_COUNT}
 } key_value_t;
 
@@ -109,12 +117,16 @@ bool get_key_state(key_value_t p_value, key_state_t p_state);
 /** framebuffer */
 bool m_resized;   // whether resized in last tick
 bool m_iconified; // whether window is iconified at end of last tick
+bool m_damaged;   // whether the contents of the window need to be drawn again in last tick
 
 void set_resized(bool p_resized);
 void set_iconified(bool p_iconified);
+void set_damaged(bool p_damaged);
 
 bool is_resized();
 
+bool is_damaged();
+
 bool is_iconified();
 
 #endif //NM_INPUT_H
@@ -155,6 +155,22 @@ int set_mat4x4(shader_program_t *t_shader_program, const char *t_name, mat4x4 t_
     return EXIT_SUCCESS;
 }
 
+int set_int(shader_program_t *t_shader_program, const char *t_name, GLint t_val)
+{
+    GLint location = glGetUniformLocation(t_shader_program->m_shader_program, t_name);
+    glUniform1i(location, t_val);
+
+    return EXIT_SUCCESS;
+}
+
+int set_float(shader_program_t *t_shader_program, const char *t_name, GLfloat t_val)
+{
+    GLint location = glGetUniformLocation(t_shader_program->m_shader_program, t_name);
+    glUniform1f(location, t_val);
+
+    return EXIT_SUCCESS;
+}
+
 int create_tex_from_file_on_disk(
         tex_t *t_tex, GLenum t_texture_unit,
         const char *t_tex_file
@@ -231,8 +247,30 @@ int create_tex_from_mem(
         format = GL_RGBA;
     }
 
+    // no mipmaps, the texture is only sampled with GL_NEAREST
     glTexImage2D(GL_TEXTURE_2D, 0, format, width, height, 0, format, GL_UNSIGNED_BYTE, t_tex_data);
-    glGenerateMipmap(GL_TEXTURE_2D);
+
+    t_tex->m_texture_unit = t_texture_unit;
+
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    return EXIT_SUCCESS;
+}
+
+int create_float_tex_from_mem(
+        tex_t *t_tex, GLenum t_texture_unit, const float *t_tex_data, uint32_t width, uint32_t height
+)
+{
+    glGenTextures(1, &t_tex->m_tex_id);
+    glBindTexture(GL_TEXTURE_2D, t_tex->m_tex_id);
+
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+
+    // rows of floats are always aligned to four bytes
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_R32F, width, height, 0, GL_RED, GL_FLOAT, t_tex_data);
 
     t_tex->m_texture_unit = t_texture_unit;
 
@@ -263,6 +301,121 @@ int delete_tex(tex_t *t_tex)
     return EXIT_SUCCESS;
 }
 
+int create_buffer_tex_from_mem(buffer_tex_t *t_tex, GLenum t_texture_unit, const float *t_data, uint32_t t_count)
+{
+    glGenBuffers(1, &t_tex->m_buffer_id);
+    glBindBuffer(GL_TEXTURE_BUFFER, t_tex->m_buffer_id);
+    glBufferData(GL_TEXTURE_BUFFER, sizeof(float) * t_count, t_data, GL_STATIC_DRAW);
+
+    glGenTextures(1, &t_tex->m_tex_id);
+    glBindTexture(GL_TEXTURE_BUFFER, t_tex->m_tex_id);
+    glTexBuffer(GL_TEXTURE_BUFFER, GL_R32F, t_tex->m_buffer_id);
+
+    t_tex->m_texture_unit = t_texture_unit;
+
+    glBindTexture(GL_TEXTURE_BUFFER, 0);
+    glBindBuffer(GL_TEXTURE_BUFFER, 0);
+
+    return EXIT_SUCCESS;
+}
+
+int update_buffer_tex(buffer_tex_t *t_tex, const float *t_data, uint32_t t_count)
+{
+    // a new data store, so that draws reading the previous one do not have to finish first
+    glBindBuffer(GL_TEXTURE_BUFFER, t_tex->m_buffer_id);
+    glBufferData(GL_TEXTURE_BUFFER, sizeof(float) * t_count, t_data, GL_STATIC_DRAW);
+    glBindBuffer(GL_TEXTURE_BUFFER, 0);
+
+    return EXIT_SUCCESS;
+}
+
+int bind_buffer_tex(buffer_tex_t *t_tex)
+{
+    glActiveTexture(t_tex->m_texture_unit);
+    glBindTexture(GL_TEXTURE_BUFFER, t_tex->m_tex_id);
+
+    return EXIT_SUCCESS;
+}
+
+int delete_buffer_tex(buffer_tex_t *t_tex)
+{
+    glDeleteTextures(1, &t_tex->m_tex_id);
+    glDeleteBuffers(1, &t_tex->m_buffer_id);
+
+    return EXIT_SUCCESS;
+}
+
+int create_streamed_tex(streamed_tex_t *t_tex, GLenum t_texture_unit, uint32_t width, uint32_t height)
+{
+    create_float_tex_from_mem(&t_tex->m_tex, t_texture_unit, NULL, width, height);
+    t_tex->m_width = width;
+    t_tex->m_height = height;
+
+    glGenBuffers(STREAM_BUFFER_COUNT, t_tex->m_pbos);
+    for (uint32_t i = 0; i < STREAM_BUFFER_COUNT; i++) {
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, t_tex->m_pbos[i]);
+        glBufferData(GL_PIXEL_UNPACK_BUFFER, sizeof(float) * width * height, NULL, GL_STREAM_DRAW);
+    }
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    t_tex->m_next_pbo = 0;
+
+    return EXIT_SUCCESS;
+}
+
+float *map_streamed_tex(streamed_tex_t *t_tex, uint32_t t_count)
+{
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, t_tex->m_pbos[t_tex->m_next_pbo]);
+    // invalidating lets the driver hand out fresh memory if the previous transfer from this buffer is pending
+    float *data = glMapBufferRange(
+            GL_PIXEL_UNPACK_BUFFER, 0, sizeof(float) * t_count, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT
+    );
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+
+    if (data == NULL) {
+        nm_log(LOG_ERROR, "could not map pixel buffer object\n");
+    }
+
+    return data;
+}
+
+int unmap_streamed_tex(streamed_tex_t *t_tex, const tex_rect_t *t_rects, uint32_t t_rect_count)
+{
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, t_tex->m_pbos[t_tex->m_next_pbo]);
+    if (glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER) == GL_FALSE) {
+        // the contents were lost, the texture keeps its previous contents
+        nm_log(LOG_WARN, "pixel buffer object was corrupted while mapped\n");
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+
+        return EXIT_FAILURE;
+    }
+
+    // with a pixel unpack buffer bound, the data pointer is an offset into it and the call does not wait
+    glBindTexture(GL_TEXTURE_2D, t_tex->m_tex.m_tex_id);
+    size_t offset = 0;
+    for (uint32_t i = 0; i < t_rect_count; i++) {
+        const tex_rect_t *rect = &t_rects[i];
+        glTexSubImage2D(
+                GL_TEXTURE_2D, 0, rect->m_x, rect->m_y, rect->m_width, rect->m_height, GL_RED, GL_FLOAT,
+                (GLvoid *) offset
+        );
+        offset += sizeof(float) * rect->m_width * rect->m_height;
+    }
+    glBindTexture(GL_TEXTURE_2D, 0);
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+
+    t_tex->m_next_pbo = (t_tex->m_next_pbo + 1) % STREAM_BUFFER_COUNT;
+
+    return EXIT_SUCCESS;
+}
+
+int delete_streamed_tex(streamed_tex_t *t_tex)
+{
+    glDeleteBuffers(STREAM_BUFFER_COUNT, t_tex->m_pbos);
+    delete_tex(&t_tex->m_tex);
+
+    return EXIT_SUCCESS;
+}
+
 const GLfloat QUAD_POS[] = {
         -1.0f, 1.0f,
         1.0f, -1.0f,
@@ -344,3 +497,39 @@ int render_ortho_tex_quad(quad *p_quad, tex_t *p_tex, mat4x4 p_model)
     return EXIT_SUCCESS;
 }
 
+int render_iteration_quad(
+        quad *p_quad, tex_t *p_iteration_tex, buffer_tex_t *p_hue_tex, float p_max_iterations, int32_t p_palette,
+        float p_offset, float p_cycle_speed, mat4x4 p_model
+)
+{
+    // obtain the shader program from id, and use it
+    shader_program_t shader_program;
+    request_program(&shader_program, SHADER_ITERATIONS);
+    use_shader_program(&shader_program);
+
+    set_mat4x4(&shader_program, "modelMatrix", p_model);
+    set_int(&shader_program, "tex_sampler", (GLint) (p_iteration_tex->m_texture_unit - GL_TEXTURE0));
+    set_int(&shader_program, "hue_sampler", (GLint) (p_hue_tex->m_texture_unit - GL_TEXTURE0));
+    set_float(&shader_program, "max_iterations", p_max_iterations);
+    set_int(&shader_program, "palette", p_palette);
+    set_float(&shader_program, "offset", p_offset);
+    set_float(&shader_program, "cycle_speed", p_cycle_speed);
+
+    // bind the hue texture first, so that the iteration texture unit is left active
+    bind_buffer_tex(p_hue_tex);
+    bind_tex(p_iteration_tex);
+
+    // draw the quad
+    glBindVertexArray(p_quad->vao);
+    glDrawArrays(GL_TRIANGLES, 0, 6);
+    glBindVertexArray(0);
+
+    // unbind shader and textures
+    unbind_tex();
+    glActiveTexture(p_hue_tex->m_texture_unit);
+    glBindTexture(GL_TEXTURE_BUFFER, 0);
+    glActiveTexture(GL_TEXTURE0);
+    unuse_shader_program();
+
+    return EXIT_SUCCESS;
+}
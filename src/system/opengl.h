@@ -31,6 +31,10 @@ int unuse_shader_program();
 
 int set_mat4x4(shader_program_t *t_shader_program, const char *t_name, mat4x4 t_val);
 
+int set_int(shader_program_t *t_shader_program, const char *t_name, GLint t_val);
+
+int set_float(shader_program_t *t_shader_program, const char *t_name, GLfloat t_val);
+
 typedef struct {
     /** Id of the texture. */
     GLuint m_tex_id;
@@ -62,6 +66,14 @@ int create_tex_from_mem(
         const unsigned char *t_tex_data, uint32_t width, uint32_t height, uint32_t t_channel_count
 );
 
+/**
+ * Single channel float texture in memory, such as iteration counts. Not filtered, so that every pixel keeps its
+ * exact value.
+ * Call to {delete_tex} is required if {EXIT_FAILURE} is returned. */
+int create_float_tex_from_mem(
+        tex_t *t_tex, GLenum t_texture_unit, const float *t_tex_data, uint32_t width, uint32_t height
+);
+
 int bind_tex(tex_t *t_tex);
 
 /** Unbinds the current texture. */
@@ -69,6 +81,66 @@ int unbind_tex();
 
 int delete_tex(tex_t *t_tex);
 
+typedef struct {
+    /** Id of the buffer holding the data. */
+    GLuint m_buffer_id;
+    /** Id of the texture. */
+    GLuint m_tex_id;
+    /** Texture unit. */
+    GLenum m_texture_unit;
+} buffer_tex_t;
+
+/**
+ * One-dimensional array of floats in a buffer texture, which is not limited by the maximum texture size.
+ * Call to {delete_buffer_tex} is required if {EXIT_FAILURE} is returned. */
+int create_buffer_tex_from_mem(buffer_tex_t *t_tex, GLenum t_texture_unit, const float *t_data, uint32_t t_count);
+
+/** Replaces the data of a buffer texture, {t_count} may differ from the previous count. */
+int update_buffer_tex(buffer_tex_t *t_tex, const float *t_data, uint32_t t_count);
+
+int bind_buffer_tex(buffer_tex_t *t_tex);
+
+int delete_buffer_tex(buffer_tex_t *t_tex);
+
+/** Number of pixel buffer objects of a {streamed_tex_t}. */
+#define STREAM_BUFFER_COUNT 2
+
+/**
+ * Single channel float texture that is kept for its size and updated in place. New data is written into one
+ * of several pixel buffer objects in turn, from which it is transferred without waiting for the transfer or
+ * for draws that still read the texture. */
+typedef struct {
+    tex_t m_tex;
+    uint32_t m_width;
+    uint32_t m_height;
+    GLuint m_pbos[STREAM_BUFFER_COUNT];
+    /** Index of the buffer the next update is written to. */
+    uint32_t m_next_pbo;
+} streamed_tex_t;
+
+/** Rectangle of texels of a {streamed_tex_t}. */
+typedef struct {
+    uint32_t m_x, m_y;
+    uint32_t m_width, m_height;
+} tex_rect_t;
+
+/**
+ * Creates a streamed texture of {width} by {height}, with undefined contents.
+ * Call to {delete_streamed_tex} is required if {EXIT_FAILURE} is returned. */
+int create_streamed_tex(streamed_tex_t *t_tex, GLenum t_texture_unit, uint32_t width, uint32_t height);
+
+/**
+ * Maps the first {t_count} floats of the next pixel buffer object and returns the memory they are written to,
+ * or NULL if it could not be mapped. Call {unmap_streamed_tex} before the texture is drawn. */
+float *map_streamed_tex(streamed_tex_t *t_tex, uint32_t t_count);
+
+/**
+ * Unmaps the buffer mapped by {map_streamed_tex} and starts the transfer of {t_rect_count} rectangles into
+ * the texture. The buffer holds the texels of the rectangles one after another, each row by row. */
+int unmap_streamed_tex(streamed_tex_t *t_tex, const tex_rect_t *t_rects, uint32_t t_rect_count);
+
+int delete_streamed_tex(streamed_tex_t *t_tex);
+
 typedef struct {
     GLuint vao;
     GLuint vbo_pos;
@@ -81,4 +153,12 @@ int delete_quad(quad *p_quad);
 
 int render_ortho_tex_quad(quad *p_quad, tex_t *p_tex, mat4x4 p_model);
 
+/**
+ * Renders {p_iteration_tex} colored by the iteration shader, with the histogram in {p_hue_tex} and the palette,
+ * offset and cycle speed of a color scheme. */
+int render_iteration_quad(
+        quad *p_quad, tex_t *p_iteration_tex, buffer_tex_t *p_hue_tex, float p_max_iterations, int32_t p_palette,
+        float p_offset, float p_cycle_speed, mat4x4 p_model
+);
+
 #endif //NM_OPENGL_H
\ No newline at end of file
@@ -6,6 +6,7 @@
 #include "opengl.h"
 
 #define SHADER_DEFAULT 0
+#define SHADER_ITERATIONS 1
 
 // todo optionally also buffer shaders instead of only shader programs
 
@@ -16,6 +17,9 @@ extern const size_t ortho_tex_vert_len;
 extern const char ortho_tex_frag[];
 extern const size_t ortho_tex_frag_len;
 
+extern const char iteration_tex_frag[];
+extern const size_t iteration_tex_frag_len;
+
 typedef struct {
     uint32_t m_id;
     /** Pointers to extern embedded data. */
@@ -31,6 +35,11 @@ static const shader_res_t SHADER_PROGRAM_RESOURCES[] = {
                 .m_id=SHADER_DEFAULT,
                 .m_vert_text=ortho_tex_vert, .m_vert_len=&ortho_tex_vert_len,
                 .m_frag_text=ortho_tex_frag, .m_frag_len=&ortho_tex_frag_len
+        },
+        {
+                .m_id=SHADER_ITERATIONS,
+                .m_vert_text=ortho_tex_vert, .m_vert_len=&ortho_tex_vert_len,
+                .m_frag_text=iteration_tex_frag, .m_frag_len=&iteration_tex_frag_len
         }
 };
 
@@ -35,6 +35,7 @@ int init_window(bool p_ortho)
     glfwSetCursorPosCallback(m_window, cursor_position_callback);
     glfwSetFramebufferSizeCallback(m_window, framebuffer_size_callback);
     glfwSetWindowIconifyCallback(m_window, window_iconify_callback);
+    glfwSetWindowRefreshCallback(m_window, window_refresh_callback);
 
     glfwMakeContextCurrent(m_window);
 
@@ -122,6 +123,16 @@ uint32_t get_window_height()
     return m_window_height;
 }
 
+double get_window_time()
+{
+    return glfwGetTime();
+}
+
+void wake_window()
+{
+    glfwPostEmptyEvent();
+}
+
 void error_callback(int t_error, const char *t_description)
 {
     nm_log(LOG_ERROR, "glfw: %s\n", t_description);
@@ -159,6 +170,51 @@ void key_callback(GLFWwindow *t_window, int t_key, int t_scancode, int t_action,
                 unset_key_state(KEY_P, DOWN);
             }
             break;
+        case GLFW_KEY_A:
+            if (t_action == GLFW_PRESS) {
+                set_key_state(KEY_A, PRESSED);
+                set_key_state(KEY_A, DOWN);
+            } else if (t_action == GLFW_RELEASE) {
+                set_key_state(KEY_A, RELEASED);
+                unset_key_state(KEY_A, DOWN);
+            }
+            break;
+        case GLFW_KEY_C:
+            if (t_action == GLFW_PRESS) {
+                set_key_state(KEY_C, PRESSED);
+                set_key_state(KEY_C, DOWN);
+            } else if (t_action == GLFW_RELEASE) {
+                set_key_state(KEY_C, RELEASED);
+                unset_key_state(KEY_C, DOWN);
+            }
+            break;
+        case GLFW_KEY_O:
+            if (t_action == GLFW_PRESS) {
+                set_key_state(KEY_O, PRESSED);
+                set_key_state(KEY_O, DOWN);
+            } else if (t_action == GLFW_RELEASE) {
+                set_key_state(KEY_O, RELEASED);
+                unset_key_state(KEY_O, DOWN);
+            }
+            break;
+        case GLFW_KEY_MINUS:
+            if (t_action == GLFW_PRESS) {
+                set_key_state(KEY_MINUS, PRESSED);
+                set_key_state(KEY_MINUS, DOWN);
+            } else if (t_action == GLFW_RELEASE) {
+                set_key_state(KEY_MINUS, RELEASED);
+                unset_key_state(KEY_MINUS, DOWN);
+            }
+            break;
+        case GLFW_KEY_EQUAL:
+            if (t_action == GLFW_PRESS) {
+                set_key_state(KEY_EQUAL, PRESSED);
+                set_key_state(KEY_EQUAL, DOWN);
+            } else if (t_action == GLFW_RELEASE) {
+                set_key_state(KEY_EQUAL, RELEASED);
+                unset_key_state(KEY_EQUAL, DOWN);
+            }
+            break;
         default:
             break;
     }
@@ -215,3 +271,8 @@ void window_iconify_callback(GLFWwindow *t_window, int t_iconified)
 {
     set_iconified(t_iconified);
 }
+
+void window_refresh_callback(GLFWwindow *t_window)
+{
+    set_damaged(true);
+}
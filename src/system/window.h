@@ -35,6 +35,12 @@ uint32_t get_window_width();
 
 uint32_t get_window_height();
 
+/** Returns the time in seconds since the window was initialized. */
+double get_window_time();
+
+/** Ends a wait for events in {pull_input}, can be called from any thread while the window exists. */
+void wake_window();
+
 /** Begin GLFW callbacks. */
 
 void error_callback(int t_error, const char *t_description);
@@ -51,6 +57,8 @@ void framebuffer_size_callback(GLFWwindow *t_window, int t_width, int t_height);
 
 void window_iconify_callback(GLFWwindow *t_window, int t_iconified);
 
+void window_refresh_callback(GLFWwindow *t_window);
+
 /** End GLFW callbacks. */
 
 #endif //NM_WINDOW_H
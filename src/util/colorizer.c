@@ -0,0 +1,232 @@
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "colorizer.h"
+#include "color.h"
+#include "mandelbrot.h"
+#include "nm_math.h"
+#include "log.h"
+
+// entries of the lookup table of {colorize} above which pixels are colored directly instead, so that neither the
+// memory nor the time to build the table grows with the maximum number of iterations beyond that of the image
+static const uint32_t MAX_LUT_SIZE = 1u << 20;
+
+void create_colorizer(colorizer_t *t_colorizer)
+{
+    memset(t_colorizer, 0, sizeof(colorizer_t));
+}
+
+void delete_colorizer(colorizer_t *t_colorizer)
+{
+    free(t_colorizer->m_lut);
+    free(t_colorizer->m_hues);
+    free(t_colorizer->m_iterations);
+}
+
+int colorizer_set_iterations(
+        colorizer_t *t_colorizer, const float *t_iterations, uint32_t t_width, uint32_t t_height,
+        uint32_t t_max_iterations
+)
+{
+    // allocated up front, so that the colorizer is left as is on failure
+    uint32_t *histogram = calloc(t_max_iterations, sizeof(uint32_t));
+    float *hues = malloc(sizeof(float) * (t_max_iterations + 1));
+    if (histogram == NULL || hues == NULL) {
+        nm_log(LOG_ERROR, "could not allocate memory for histogram of %u iterations\n", t_max_iterations);
+        free(hues);
+        free(histogram);
+
+        return EXIT_FAILURE;
+    }
+
+    uint32_t count = t_width * t_height;
+    if (t_colorizer->m_width * t_colorizer->m_height != count) {
+        float *iterations = realloc(t_colorizer->m_iterations, sizeof(float) * count);
+        if (iterations == NULL) {
+            nm_log(LOG_ERROR, "could not allocate memory for %u iterations\n", count);
+            free(hues);
+            free(histogram);
+
+            return EXIT_FAILURE;
+        }
+        t_colorizer->m_iterations = iterations;
+    }
+    t_colorizer->m_width = t_width;
+    t_colorizer->m_height = t_height;
+    memcpy(t_colorizer->m_iterations, t_iterations, sizeof(float) * count);
+
+    /** count the frequencies of all values except the maximum */
+    uint32_t total = 0;
+    for (uint32_t i = 0; i < count; i++) {
+        if (t_iterations[i] < t_max_iterations) {
+            histogram[(uint32_t) floorf(t_iterations[i])]++;
+            total++;
+        }
+    }
+
+    // the histogram palette follows the histogram, the linear and log palettes and the size of the table the maximum
+    if (t_colorizer->m_lut_scheme.palette == PALETTE_HISTOGRAM || t_colorizer->m_max_iterations != t_max_iterations) {
+        t_colorizer->m_lut_valid = false;
+    }
+
+    /** construct a hue map for all possible values */
+    free(t_colorizer->m_hues);
+    t_colorizer->m_hues = hues;
+    t_colorizer->m_max_iterations = t_max_iterations;
+    float h = 0;
+    for (uint32_t i = 0; i < t_max_iterations; i++) {
+        // a view without escaped pixels keeps all hues at zero
+        h += total > 0 ? histogram[i] / (float) total : 0.f;
+        t_colorizer->m_hues[i] = h;
+    }
+    t_colorizer->m_hues[t_max_iterations] = h;
+
+    free(histogram);
+
+    return EXIT_SUCCESS;
+}
+
+/** Position on the hue circle of iteration count {m}, without the offset. */
+static float palette_position(const colorizer_t *t_colorizer, color_scheme_t t_scheme, float m)
+{
+    switch (t_scheme.palette) {
+        case PALETTE_LINEAR:
+            return m / (float) t_colorizer->m_max_iterations;
+        case PALETTE_CYCLIC:
+            return m * t_scheme.cycle_speed;
+        case PALETTE_LOG:
+            return log1pf(m) / log1pf((float) t_colorizer->m_max_iterations);
+        default: { // case PALETTE_HISTOGRAM:
+            uint32_t n = (uint32_t) m;
+            return nm_lerpf(t_colorizer->m_hues[n], t_colorizer->m_hues[n + 1], m - (float) n);
+        }
+    }
+}
+
+/** Fills {t_hue_colors} with the RGBA color of every hue, the hue is a byte so every color is one of 256. */
+static void fill_hue_colors(uint32_t *t_hue_colors)
+{
+    for (uint32_t h = 0; h < 256; h++) {
+        color_t hsv;
+        hsv.h = h;
+        hsv.s = 255;
+        hsv.v = 255;
+        color_t rgb = HSVtoRGB(hsv);
+        uint8_t rgba[4] = {rgb.r, rgb.g, rgb.b, 255};
+        memcpy(&t_hue_colors[h], rgba, sizeof(rgba));
+    }
+}
+
+/** Color of entry {t_index} of the lookup table of {colorize}, the iteration count {t_index} / {PALETTE_STEPS}. */
+static uint32_t lut_entry(
+        const colorizer_t *t_colorizer, color_scheme_t t_scheme, const uint32_t *t_hue_colors, uint32_t t_index
+)
+{
+    float position = palette_position(t_colorizer, t_scheme, (float) t_index / (float) PALETTE_STEPS);
+    position += t_scheme.offset;
+    // palettes other than the cyclic one end at exactly one, which is kept as is
+    if (position > 1.f) {
+        position -= floorf(position);
+    }
+
+    return t_hue_colors[255 - (uint32_t) (255 * position)];
+}
+
+/**
+ * Builds the lookup table of {colorize} for {t_scheme}, unless it is already built for it. A table of more than
+ * {MAX_LUT_SIZE} entries is not built and {m_lut} is left NULL, see {colorize_direct}. */
+static int update_lut(colorizer_t *t_colorizer, color_scheme_t t_scheme)
+{
+    color_scheme_t built = t_colorizer->m_lut_scheme;
+    if (t_colorizer->m_lut_valid && built.palette == t_scheme.palette && built.offset == t_scheme.offset &&
+        built.cycle_speed == t_scheme.cycle_speed) {
+        return EXIT_SUCCESS;
+    }
+
+    if ((uint64_t) t_colorizer->m_max_iterations * PALETTE_STEPS > MAX_LUT_SIZE) {
+        free(t_colorizer->m_lut);
+        t_colorizer->m_lut = NULL;
+        t_colorizer->m_lut_size = 0;
+        t_colorizer->m_lut_valid = false;
+
+        return EXIT_SUCCESS;
+    }
+    uint32_t size = t_colorizer->m_max_iterations * PALETTE_STEPS;
+
+    uint32_t hue_colors[256];
+    fill_hue_colors(hue_colors);
+
+    /** construct the lookup table of {colorize}, with {PALETTE_STEPS} entries per iteration */
+    if (t_colorizer->m_lut == NULL || t_colorizer->m_lut_size != size) {
+        uint32_t *lut = realloc(t_colorizer->m_lut, sizeof(uint32_t) * (size + 1));
+        if (lut == NULL) {
+            nm_log(LOG_ERROR, "could not allocate memory for lookup table of %u entries\n", size + 1);
+            t_colorizer->m_lut_valid = false;
+
+            return EXIT_FAILURE;
+        }
+        t_colorizer->m_lut = lut;
+        t_colorizer->m_lut_size = size;
+    }
+    uint32_t *lut = t_colorizer->m_lut;
+    for (uint32_t i = 0; i < size; i++) {
+        lut[i] = lut_entry(t_colorizer, t_scheme, hue_colors, i);
+    }
+
+    // interior and undecided pixels are black
+    uint8_t black[4] = {0, 0, 0, 255};
+    memcpy(&lut[size], black, sizeof(black));
+
+    t_colorizer->m_lut_scheme = t_scheme;
+    t_colorizer->m_lut_valid = true;
+
+    return EXIT_SUCCESS;
+}
+
+/**
+ * Writes the colors of {t_count} iteration counts into {t_pixels} like {colorize}, without a lookup table, for a
+ * maximum too large for one. Counts are rounded down to {PALETTE_STEPS} per iteration like for the table. */
+static void colorize_direct(
+        const colorizer_t *t_colorizer, color_scheme_t t_scheme, const float *t_iterations, uint32_t t_count,
+        uint32_t *t_pixels
+)
+{
+    uint32_t hue_colors[256];
+    fill_hue_colors(hue_colors);
+
+    uint8_t black[4] = {0, 0, 0, 255};
+    uint32_t interior;
+    memcpy(&interior, black, sizeof(black));
+
+    uint64_t size = (uint64_t) t_colorizer->m_max_iterations * PALETTE_STEPS;
+    for (uint32_t i = 0; i < t_count; i++) {
+        uint64_t index = (uint64_t) (t_iterations[i] * (float) PALETTE_STEPS);
+        t_pixels[i] = index < size ? lut_entry(t_colorizer, t_scheme, hue_colors, (uint32_t) index) : interior;
+    }
+}
+
+int colorizer_apply(colorizer_t *t_colorizer, color_scheme_t t_scheme, uint8_t *t_pixels)
+{
+    return colorizer_apply_to(
+            t_colorizer, t_scheme, t_colorizer->m_iterations, t_colorizer->m_width * t_colorizer->m_height, t_pixels
+    );
+}
+
+int colorizer_apply_to(
+        colorizer_t *t_colorizer, color_scheme_t t_scheme, const float *t_iterations, uint32_t t_count,
+        uint8_t *t_pixels
+)
+{
+    if (update_lut(t_colorizer, t_scheme) == EXIT_FAILURE) {
+        return EXIT_FAILURE;
+    }
+
+    /** look up the color of every pixel, four bytes per pixel */
+    if (t_colorizer->m_lut == NULL) {
+        colorize_direct(t_colorizer, t_scheme, t_iterations, t_count, (uint32_t *) t_pixels);
+    } else {
+        colorize((uint32_t *) t_pixels, t_iterations, t_count, t_colorizer->m_lut);
+    }
+
+    return EXIT_SUCCESS;
+}
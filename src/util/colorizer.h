@@ -0,0 +1,79 @@
+#ifndef MANDELBROT_COLORIZER_H
+#define MANDELBROT_COLORIZER_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/** How iteration counts are mapped onto the hue circle. */
+#define PALETTE_COUNT 4 // number of palettes defined in {palette_t}
+typedef enum {
+    // by the fraction of pixels with a lower count, which spreads the hues evenly over the view
+    PALETTE_HISTOGRAM = 0,
+    // by the count relative to the maximum
+    PALETTE_LINEAR,
+    // by the count times the cycling speed, repeating the hue circle
+    PALETTE_CYCLIC,
+    // by the logarithm of the count relative to that of the maximum
+    PALETTE_LOG
+    // NB: update {PALETTE_COUNT} and {PALETTE_NAMES}
+} palette_t;
+
+static const char *PALETTE_NAMES[] = {
+        "histogram", "linear", "cyclic", "log"
+};
+
+typedef struct {
+    palette_t palette;
+    // added to the position on the hue circle, in [0, 1)
+    float offset;
+    // number of times per iteration the hue circle is passed for {PALETTE_CYCLIC}
+    float cycle_speed;
+} color_scheme_t;
+
+/** Colors iteration buffers, keeping a copy of the last one so that it can be colored again with another scheme. */
+typedef struct {
+    float *m_iterations;
+    uint32_t m_width;
+    uint32_t m_height;
+    uint32_t m_max_iterations;
+    // fraction of the pixels with a count below every integer count up to the maximum, for {PALETTE_HISTOGRAM}
+    float *m_hues;
+    // lookup table of {colorize} for {m_lut_scheme}, kept until the scheme or the positions of the palette change,
+    // NULL for a maximum too large for a table, of which the pixels are colored directly
+    uint32_t *m_lut;
+    uint32_t m_lut_size;
+    color_scheme_t m_lut_scheme;
+    bool m_lut_valid;
+} colorizer_t;
+
+/** Creates a colorizer without iterations, call to {delete_colorizer} is required. */
+void create_colorizer(colorizer_t *t_colorizer);
+
+void delete_colorizer(colorizer_t *t_colorizer);
+
+/**
+ * Copies the iteration counts of {t_width} by {t_height} pixels, which are in [0, {t_max_iterations}] with the
+ * maximum for interior points, and computes their histogram. Returns {EXIT_FAILURE} if memory could not be
+ * allocated, in which case the previous iterations are kept. */
+int colorizer_set_iterations(
+        colorizer_t *t_colorizer, const float *t_iterations, uint32_t t_width, uint32_t t_height,
+        uint32_t t_max_iterations
+);
+
+/**
+ * Writes the color of every iteration count into {t_pixels} as RGBA bytes, interior points are black. Changing
+ * {t_scheme} does not require new iterations. The iteration shader computes the same colors on the gpu, from
+ * the iterations and {m_hues}. Returns {EXIT_FAILURE} if the lookup table could not be allocated. */
+int colorizer_apply(colorizer_t *t_colorizer, color_scheme_t t_scheme, uint8_t *t_pixels);
+
+/**
+ * Like {colorizer_apply}, for {t_count} iteration counts of another part of the same view, which are in
+ * [0, {m_max_iterations}]. The histogram palette uses the histogram of the kept iterations, so that a view that
+ * is too large to keep can be colored in parts with the histogram of a smaller version of it. The lookup table
+ * is built once for all parts. */
+int colorizer_apply_to(
+        colorizer_t *t_colorizer, color_scheme_t t_scheme, const float *t_iterations, uint32_t t_count,
+        uint8_t *t_pixels
+);
+
+#endif //MANDELBROT_COLORIZER_H
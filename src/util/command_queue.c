@@ -0,0 +1,115 @@
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "command_queue.h"
+#include "log.h"
+
+// time to wait before returning when none of the waiting commands fit, so that the consumer does not spin
+static const long TAKE_RETRY_NANOSECONDS = 100000000;
+
+int create_command_queue(command_queue_t *t_queue)
+{
+    t_queue->m_capacity = 16;
+    if ((t_queue->m_commands = malloc(sizeof(command_t) * t_queue->m_capacity)) == NULL) {
+        nm_log(LOG_ERROR, "could not allocate memory for command queue\n");
+
+        return EXIT_FAILURE;
+    }
+    t_queue->m_count = 0;
+    atomic_init(&t_queue->m_pending, false);
+    pthread_mutex_init(&t_queue->m_mutex, NULL);
+    pthread_cond_init(&t_queue->m_cv, NULL);
+
+    return EXIT_SUCCESS;
+}
+
+void delete_command_queue(command_queue_t *t_queue)
+{
+    pthread_cond_destroy(&t_queue->m_cv);
+    pthread_mutex_destroy(&t_queue->m_mutex);
+    free(t_queue->m_commands);
+}
+
+/** Returns whether {t_command} replaces a command of the same type, so that only the last one matters. */
+static bool replaces_previous(const command_t *t_command)
+{
+    return t_command->m_type == COMMAND_RESIZE || t_command->m_type == COMMAND_SET_SAMPLES;
+}
+
+int command_queue_push(command_queue_t *t_queue, command_t t_command)
+{
+    pthread_mutex_lock(&t_queue->m_mutex);
+    {
+        command_t *last = t_queue->m_count > 0 ? &t_queue->m_commands[t_queue->m_count - 1] : NULL;
+        if (last != NULL && last->m_type == t_command.m_type && replaces_previous(&t_command)) {
+            *last = t_command;
+        } else {
+            if (t_queue->m_count == t_queue->m_capacity) {
+                command_t *commands = realloc(t_queue->m_commands, sizeof(command_t) * t_queue->m_capacity * 2);
+                if (commands != NULL) {
+                    t_queue->m_commands = commands;
+                    t_queue->m_capacity *= 2;
+                } else if (t_command.m_type == COMMAND_QUIT) {
+                    // quitting makes the waiting commands pointless, so it takes the place of the last one
+                    t_queue->m_count--;
+                } else {
+                    pthread_mutex_unlock(&t_queue->m_mutex);
+                    nm_log(LOG_ERROR, "could not grow command queue\n");
+
+                    return EXIT_FAILURE;
+                }
+            }
+            t_queue->m_commands[t_queue->m_count++] = t_command;
+        }
+
+        // set under the mutex, so that it is never cleared while a command is waiting
+        atomic_store(&t_queue->m_pending, true);
+        pthread_cond_signal(&t_queue->m_cv);
+    }
+    pthread_mutex_unlock(&t_queue->m_mutex);
+
+    return EXIT_SUCCESS;
+}
+
+uint32_t command_queue_take(command_queue_t *t_queue, command_t **t_commands, uint32_t *t_capacity, bool t_wait)
+{
+    uint32_t count;
+    pthread_mutex_lock(&t_queue->m_mutex);
+    {
+        while (t_wait && t_queue->m_count == 0) {
+            pthread_cond_wait(&t_queue->m_cv, &t_queue->m_mutex);
+        }
+
+        count = t_queue->m_count;
+        if (count > *t_capacity) {
+            command_t *commands = realloc(*t_commands, sizeof(command_t) * t_queue->m_capacity);
+            if (commands != NULL) {
+                *t_commands = commands;
+                *t_capacity = t_queue->m_capacity;
+            } else {
+                // the commands that do not fit are left waiting, in order
+                nm_log(LOG_ERROR, "could not grow taken commands\n");
+                count = *t_capacity;
+                if (count == 0) {
+                    // none fit, so back off before the caller tries again
+                    struct timespec until;
+                    clock_gettime(CLOCK_REALTIME, &until);
+                    until.tv_nsec += TAKE_RETRY_NANOSECONDS;
+                    if (until.tv_nsec >= 1000000000) {
+                        until.tv_sec++;
+                        until.tv_nsec -= 1000000000;
+                    }
+                    pthread_cond_timedwait(&t_queue->m_cv, &t_queue->m_mutex, &until);
+                }
+            }
+        }
+        memcpy(*t_commands, t_queue->m_commands, sizeof(command_t) * count);
+
+        t_queue->m_count -= count;
+        memmove(t_queue->m_commands, &t_queue->m_commands[count], sizeof(command_t) * t_queue->m_count);
+        atomic_store(&t_queue->m_pending, t_queue->m_count > 0);
+    }
+    pthread_mutex_unlock(&t_queue->m_mutex);
+
+    return count;
+}
@@ -0,0 +1,78 @@
+#ifndef MANDELBROT_COMMAND_QUEUE_H
+#define MANDELBROT_COMMAND_QUEUE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdatomic.h>
+#include <pthread.h>
+
+typedef enum {
+    /** Zooms into a rectangle of the current view, pushing the new view on the stack. */
+    COMMAND_ZOOM_IN,
+    /** Returns to the previous view on the stack. */
+    COMMAND_ZOOM_OUT,
+    /** Changes the size of the views, which starts over from the first view. */
+    COMMAND_RESIZE,
+    /** Changes the number of samples per pixel in both directions, which starts the view over. */
+    COMMAND_SET_SAMPLES,
+    /** Stops the consumer. */
+    COMMAND_QUIT,
+} command_type_t;
+
+/** Change to the view, sent from the main thread to the compute thread. */
+typedef struct {
+    command_type_t m_type;
+    union {
+        /** {COMMAND_ZOOM_IN}, the center is moved by the offsets and the size is multiplied by the factors, all as
+         * fractions of the current size, see {zoom_fractal}. */
+        struct {
+            double m_re_offset, m_im_offset;
+            double m_re_factor, m_im_factor;
+        } m_zoom;
+        /** {COMMAND_RESIZE} */
+        struct {
+            uint32_t m_width, m_height;
+        } m_size;
+        /** {COMMAND_SET_SAMPLES} */
+        uint32_t m_samples_per_pixel;
+    };
+} command_t;
+
+/**
+ * Queue of commands from a single producer to a single consumer, which takes all waiting commands at once
+ * and applies them before computing again, so that a burst of commands results in a single computation.
+ * A command that replaces the previous waiting one of the same type, a resize or a change of samples, is
+ * merged into it. */
+typedef struct {
+    command_t *m_commands;
+    uint32_t m_count;
+    uint32_t m_capacity;
+
+    /** Set while commands are waiting, the computation in progress is abandoned when it is set. */
+    atomic_bool m_pending;
+
+    /** Protects the commands, only held while pushing or taking. */
+    pthread_mutex_t m_mutex;
+    /** Signaled when a command is pushed. */
+    pthread_cond_t m_cv;
+} command_queue_t;
+
+/** Creates an empty queue. Call to {delete_command_queue} is required if {EXIT_SUCCESS} is returned. */
+int create_command_queue(command_queue_t *t_queue);
+
+void delete_command_queue(command_queue_t *t_queue);
+
+/**
+ * Adds {t_command} to the queue, or merges it into the last waiting command, and sets {m_pending}. Returns
+ * {EXIT_FAILURE} if the queue could not grow, in which case the command is dropped. {COMMAND_QUIT} is never
+ * dropped, it replaces the last waiting command instead. */
+int command_queue_push(command_queue_t *t_queue, command_t t_command);
+
+/**
+ * Moves all waiting commands into {t_commands}, which holds {t_capacity} commands and is grown if needed, and
+ * clears {m_pending}. If {t_commands} cannot grow, only the first commands that fit are moved and the others
+ * keep waiting, if none fit it waits for a tenth of a second or the next command before returning none.
+ * If {t_wait}, blocks until there is at least one command. Returns the number of commands. */
+uint32_t command_queue_take(command_queue_t *t_queue, command_t **t_commands, uint32_t *t_capacity, bool t_wait);
+
+#endif //MANDELBROT_COMMAND_QUEUE_H
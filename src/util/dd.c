@@ -0,0 +1,111 @@
+// the error free transformations below are only exact without fused multiply-add
+#pragma GCC optimize ("fp-contract=off")
+
+#include "dd.h"
+#include "mandelbrot.h"
+
+/** Sum of {a} and {b} with its rounding error. */
+static inline dd_t two_sum(double a, double b)
+{
+    double s = a + b;
+    double bb = s - a;
+    dd_t result = {s, (a - (s - bb)) + (b - bb)};
+    return result;
+}
+
+/** Sum of {a} and {b} with its rounding error, requires |a| >= |b|. */
+static inline dd_t quick_two_sum(double a, double b)
+{
+    double s = a + b;
+    dd_t result = {s, b - (s - a)};
+    return result;
+}
+
+/** Product of {a} and {b} with its rounding error, using Dekker's split. */
+static inline dd_t two_prod(double a, double b)
+{
+    const double SPLITTER = 134217729.0; // 2^27 + 1
+    double p = a * b;
+
+    double t = SPLITTER * a;
+    double a_hi = t - (t - a);
+    double a_lo = a - a_hi;
+    t = SPLITTER * b;
+    double b_hi = t - (t - b);
+    double b_lo = b - b_hi;
+
+    dd_t result = {p, ((a_hi * b_hi - p) + a_hi * b_lo + a_lo * b_hi) + a_lo * b_lo};
+    return result;
+}
+
+static inline dd_t dd_add(dd_t x, dd_t y)
+{
+    dd_t s = two_sum(x.hi, y.hi);
+    dd_t t = two_sum(x.lo, y.lo);
+    s.lo += t.hi;
+    s = quick_two_sum(s.hi, s.lo);
+    s.lo += t.lo;
+    return quick_two_sum(s.hi, s.lo);
+}
+
+static inline dd_t dd_sub(dd_t x, dd_t y)
+{
+    dd_t neg = {-y.hi, -y.lo};
+    return dd_add(x, neg);
+}
+
+static inline dd_t dd_mul(dd_t x, dd_t y)
+{
+    dd_t p = two_prod(x.hi, y.hi);
+    p.lo += x.hi * y.lo + x.lo * y.hi;
+    return quick_two_sum(p.hi, p.lo);
+}
+
+static inline dd_t dd_sqr(dd_t x)
+{
+    dd_t p = two_prod(x.hi, x.hi);
+    p.lo += 2 * x.hi * x.lo;
+    return quick_two_sum(p.hi, p.lo);
+}
+
+dd_t dd_from_hp(hp_t x)
+{
+    double hi = hp_to_double(x);
+    dd_t result = {hi, hp_to_double(hp_sub(x, hp_from_double(hi)))};
+    return quick_two_sum(result.hi, result.lo);
+}
+
+dd_t dd_add_double(dd_t x, double y)
+{
+    dd_t s = two_sum(x.hi, y);
+    s.lo += x.lo;
+    return quick_two_sum(s.hi, s.lo);
+}
+
+void dd_span_scalar(
+        float *p_out, double *p_zr, double *p_zr_lo, double *p_zi, double *p_zi_lo,
+        const double *p_cr, const double *p_cr_lo, const double *p_ci, const double *p_ci_lo,
+        uint32_t count, uint32_t n_start, uint32_t n_end
+)
+{
+    for (uint32_t i = 0; i < count; i++) {
+        dd_t zr = {p_zr[i], p_zr_lo[i]}, zi = {p_zi[i], p_zi_lo[i]};
+        dd_t cr = {p_cr[i], p_cr_lo[i]}, ci = {p_ci[i], p_ci_lo[i]};
+        uint32_t n = n_start;
+
+        // the bailout only needs the high parts
+        while (zr.hi * zr.hi + zi.hi * zi.hi <= 4 && n < n_end) {
+            dd_t zrzi = dd_mul(zr, zi);
+            dd_t zr_next = dd_add(dd_sub(dd_sqr(zr), dd_sqr(zi)), cr);
+            zi = dd_add(dd_add(zrzi, zrzi), ci);
+            zr = zr_next;
+            n++;
+        }
+
+        p_zr[i] = zr.hi;
+        p_zr_lo[i] = zr.lo;
+        p_zi[i] = zi.hi;
+        p_zi_lo[i] = zi.lo;
+        p_out[i] = n == n_end ? -1.f : mandelbrot_smooth(n, zr.hi * zr.hi + zi.hi * zi.hi, n_end);
+    }
+}
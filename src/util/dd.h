@@ -0,0 +1,27 @@
+#ifndef MANDELBROT_DD_H
+#define MANDELBROT_DD_H
+
+#include <stdint.h>
+#include "hp.h"
+
+/** Double-double number, the unevaluated sum of two doubles with {lo} at most half an ulp of {hi}. */
+typedef struct {
+    double hi;
+    double lo;
+} dd_t;
+
+/** Converts a high precision number, keeping about 106 bits. */
+dd_t dd_from_hp(hp_t x);
+
+dd_t dd_add_double(dd_t x, double y);
+
+/**
+ * Counterpart of {mandelbrot_span} with z and c in double-double, as pairs of arrays with the high and
+ * low parts. Used for views too deep for doubles but not deep enough to need perturbation. */
+void dd_span_scalar(
+        float *p_out, double *p_zr, double *p_zr_lo, double *p_zi, double *p_zi_lo,
+        const double *p_cr, const double *p_cr_lo, const double *p_ci, const double *p_ci_lo,
+        uint32_t count, uint32_t n_start, uint32_t n_end
+);
+
+#endif //MANDELBROT_DD_H
@@ -0,0 +1,254 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <sys/stat.h>
+#include "dzi_writer.h"
+#include "png_writer.h"
+#include "log.h"
+
+// number of rows of a level a worker downsamples at a time
+#define DOWNSAMPLE_TASK_ROWS 16
+
+/** Tile of the current row of tiles of a level, written by a worker. */
+typedef struct {
+    dzi_writer_t *m_writer;
+    uint32_t m_level;
+    uint32_t m_column;
+} tile_task_t;
+
+/** Rows of the level below, averaged from the current row of tiles of a level by a worker. */
+typedef struct {
+    const dzi_level_t *m_child;
+    dzi_level_t *m_parent;
+    // rows of the band of the parent, relative to the start of the band
+    uint32_t m_y0, m_y1;
+    // row of the band of the parent the band of the child starts at
+    uint32_t m_offset;
+} downsample_task_t;
+
+static int make_directory(const char *t_path)
+{
+    return mkdir(t_path, 0755) == 0 || errno == EEXIST ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+int create_dzi_writer(
+        dzi_writer_t *t_writer, const char *t_path, uint32_t t_width, uint32_t t_height, thread_pool_t *t_pool
+)
+{
+    memset(t_writer, 0, sizeof(dzi_writer_t));
+    size_t length = strlen(t_path);
+    if (length < 4 || strcmp(&t_path[length - 4], ".dzi") != 0 || t_width == 0 || t_height == 0) {
+        return EXIT_FAILURE;
+    }
+    t_writer->m_pool = t_pool;
+    atomic_init(&t_writer->m_failed, false);
+
+    t_writer->m_path = malloc(length + 1);
+    t_writer->m_directory = malloc(length + 3);
+    if (t_writer->m_path == NULL || t_writer->m_directory == NULL) {
+        nm_log(LOG_ERROR, "could not allocate memory for the paths of pyramid %s\n", t_path);
+        delete_dzi_writer(t_writer);
+
+        return EXIT_FAILURE;
+    }
+    strcpy(t_writer->m_path, t_path);
+    snprintf(t_writer->m_directory, length + 3, "%.*s_files", (int) (length - 4), t_path);
+
+    // the finest level is the first that is at least as large as the image, level 0 is a single pixel
+    uint32_t size = t_width > t_height ? t_width : t_height;
+    t_writer->m_level_count = 1;
+    while ((1ull << (t_writer->m_level_count - 1)) < size) t_writer->m_level_count++;
+
+    /** levels and their directories */
+    char *path = malloc(length + 16);
+    t_writer->m_levels = calloc(t_writer->m_level_count, sizeof(dzi_level_t));
+    if (path == NULL || t_writer->m_levels == NULL) {
+        nm_log(LOG_ERROR, "could not allocate memory for the levels of pyramid %s\n", t_path);
+        free(path);
+        delete_dzi_writer(t_writer);
+
+        return EXIT_FAILURE;
+    }
+    int result = make_directory(t_writer->m_directory);
+    for (uint32_t i = 0; i < t_writer->m_level_count; i++) {
+        dzi_level_t *level = &t_writer->m_levels[i];
+        uint32_t shift = t_writer->m_level_count - 1 - i;
+        level->m_width = (uint32_t) (((uint64_t) t_width + (1ull << shift) - 1) >> shift);
+        level->m_height = (uint32_t) (((uint64_t) t_height + (1ull << shift) - 1) >> shift);
+        level->m_band = malloc(sizeof(uint8_t) * level->m_width * DZI_TILE_SIZE * 3);
+        if (level->m_band == NULL) {
+            nm_log(LOG_ERROR, "could not allocate memory for level %u of pyramid %s\n", i, t_path);
+            result = EXIT_FAILURE;
+            break;
+        }
+
+        snprintf(path, length + 16, "%s/%u", t_writer->m_directory, i);
+        if (result == EXIT_SUCCESS) result = make_directory(path);
+    }
+    free(path);
+
+    if (result == EXIT_FAILURE) delete_dzi_writer(t_writer);
+    return result;
+}
+
+static void write_tile(void *t_arg, uint32_t t_worker)
+{
+    tile_task_t *task = t_arg;
+    dzi_writer_t *writer = task->m_writer;
+    const dzi_level_t *level = &writer->m_levels[task->m_level];
+    if (atomic_load(&writer->m_failed)) return;
+
+    uint32_t x = task->m_column * DZI_TILE_SIZE;
+    uint32_t width = x + DZI_TILE_SIZE < level->m_width ? DZI_TILE_SIZE : level->m_width - x;
+    size_t length = strlen(writer->m_directory) + 48;
+    char *path = malloc(length);
+    if (path == NULL) {
+        atomic_store(&writer->m_failed, true);
+        return;
+    }
+    snprintf(path, length, "%s/%u/%u_%u.png", writer->m_directory, task->m_level, task->m_column, level->m_tile_row);
+
+    png_writer_t png;
+    bool written = create_png_writer(&png, path, width, level->m_band_rows, 3) == EXIT_SUCCESS;
+    if (written) {
+        for (uint32_t y = 0; y < level->m_band_rows; y++) {
+            png_writer_write_rows(&png, &level->m_band[((size_t) y * level->m_width + x) * 3], 1);
+        }
+        written = delete_png_writer(&png) == EXIT_SUCCESS;
+    }
+    if (!written) atomic_store(&writer->m_failed, true);
+    free(path);
+}
+
+static void downsample_rows(void *t_arg, uint32_t t_worker)
+{
+    downsample_task_t *task = t_arg;
+    const dzi_level_t *child = task->m_child;
+    dzi_level_t *parent = task->m_parent;
+
+    for (uint32_t y = task->m_y0; y < task->m_y1; y++) {
+        // a child with an odd number of rows or columns repeats its last one
+        const uint8_t *row0 = &child->m_band[(size_t) 2 * y * child->m_width * 3];
+        const uint8_t *row1 = 2 * y + 1 < child->m_band_rows ? &row0[child->m_width * 3] : row0;
+        uint8_t *out = &parent->m_band[(size_t) (task->m_offset + y) * parent->m_width * 3];
+        for (uint32_t x = 0; x < parent->m_width; x++) {
+            uint32_t x0 = 2 * x * 3;
+            uint32_t x1 = 2 * x + 1 < child->m_width ? x0 + 3 : x0;
+            for (uint32_t c = 0; c < 3; c++) {
+                out[x * 3 + c] = (uint8_t) ((row0[x0 + c] + row0[x1 + c] + row1[x0 + c] + row1[x1 + c] + 2) / 4);
+            }
+        }
+    }
+}
+
+/**
+ * Writes the tiles of the current row of tiles of level {t_index}, and adds its downsampled rows to the level
+ * below, which is flushed in turn once its row of tiles is complete. */
+static void flush_level(dzi_writer_t *t_writer, uint32_t t_index)
+{
+    dzi_level_t *level = &t_writer->m_levels[t_index];
+
+    /** tiles */
+    uint32_t column_count = (level->m_width + DZI_TILE_SIZE - 1) / DZI_TILE_SIZE;
+    tile_task_t *tiles = malloc(sizeof(tile_task_t) * column_count);
+    if (tiles == NULL) {
+        nm_log(LOG_ERROR, "could not allocate memory for the tiles of level %u\n", t_index);
+        atomic_store(&t_writer->m_failed, true);
+        return;
+    }
+    for (uint32_t i = 0; i < column_count; i++) {
+        tiles[i] = (tile_task_t) {t_writer, t_index, i};
+        if (thread_pool_submit(t_writer->m_pool, write_tile, &tiles[i]) == EXIT_FAILURE) {
+            atomic_store(&t_writer->m_failed, true);
+        }
+    }
+
+    /** rows of the level below, which depend on the same rows and are computed alongside the tiles */
+    dzi_level_t *parent = t_index > 0 ? &t_writer->m_levels[t_index - 1] : NULL;
+    uint32_t parent_rows = (level->m_band_rows + 1) / 2;
+    uint32_t task_count = parent != NULL ? (parent_rows + DOWNSAMPLE_TASK_ROWS - 1) / DOWNSAMPLE_TASK_ROWS : 0;
+    downsample_task_t *rows = malloc(sizeof(downsample_task_t) * (task_count > 0 ? task_count : 1));
+    if (rows == NULL) {
+        nm_log(LOG_ERROR, "could not allocate memory for the rows below level %u\n", t_index);
+        atomic_store(&t_writer->m_failed, true);
+        task_count = 0;
+    }
+    for (uint32_t t = 0; t < task_count; t++) {
+        uint32_t y0 = t * DOWNSAMPLE_TASK_ROWS;
+        uint32_t y1 = y0 + DOWNSAMPLE_TASK_ROWS < parent_rows ? y0 + DOWNSAMPLE_TASK_ROWS : parent_rows;
+        rows[t] = (downsample_task_t) {level, parent, y0, y1, parent->m_band_rows};
+        if (thread_pool_submit(t_writer->m_pool, downsample_rows, &rows[t]) == EXIT_FAILURE) {
+            atomic_store(&t_writer->m_failed, true);
+        }
+    }
+    thread_pool_wait(t_writer->m_pool);
+    free(rows);
+    free(tiles);
+    if (atomic_load(&t_writer->m_failed)) return;
+
+    t_writer->m_tile_count += column_count;
+    level->m_tile_row++;
+    level->m_band_rows = 0;
+
+    if (parent != NULL) {
+        parent->m_band_rows += parent_rows;
+        uint32_t parent_end = parent->m_tile_row * DZI_TILE_SIZE + parent->m_band_rows;
+        if (parent->m_band_rows == DZI_TILE_SIZE || parent_end == parent->m_height) {
+            flush_level(t_writer, t_index - 1);
+        }
+    }
+}
+
+int dzi_writer_write_rows(dzi_writer_t *t_writer, const uint8_t *t_pixels, uint32_t t_count)
+{
+    dzi_level_t *level = &t_writer->m_levels[t_writer->m_level_count - 1];
+    size_t row_size = (size_t) level->m_width * 3;
+    for (uint32_t r = 0; r < t_count && !atomic_load(&t_writer->m_failed); r++) {
+        uint32_t end = level->m_tile_row * DZI_TILE_SIZE + level->m_band_rows;
+        if (end == level->m_height) break;
+
+        memcpy(&level->m_band[level->m_band_rows * row_size], &t_pixels[r * row_size], row_size);
+        level->m_band_rows++;
+        if (level->m_band_rows == DZI_TILE_SIZE || end + 1 == level->m_height) {
+            flush_level(t_writer, t_writer->m_level_count - 1);
+        }
+    }
+
+    return atomic_load(&t_writer->m_failed) ? EXIT_FAILURE : EXIT_SUCCESS;
+}
+
+int delete_dzi_writer(dzi_writer_t *t_writer)
+{
+    bool complete = false;
+    if (t_writer->m_levels != NULL && !atomic_load(&t_writer->m_failed)) {
+        const dzi_level_t *finest = &t_writer->m_levels[t_writer->m_level_count - 1];
+        complete = (uint64_t) finest->m_tile_row * DZI_TILE_SIZE >= finest->m_height;
+    }
+
+    if (complete) {
+        FILE *file = fopen(t_writer->m_path, "w");
+        complete = file != NULL;
+        if (complete) {
+            fprintf(
+                    file,
+                    "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
+                    "<Image xmlns=\"http://schemas.microsoft.com/deepzoom/2008\" Format=\"png\" Overlap=\"0\" "
+                    "TileSize=\"%u\">\n"
+                    "    <Size Width=\"%u\" Height=\"%u\"/>\n"
+                    "</Image>\n", DZI_TILE_SIZE, t_writer->m_levels[t_writer->m_level_count - 1].m_width,
+                    t_writer->m_levels[t_writer->m_level_count - 1].m_height
+            );
+            complete = fclose(file) == 0;
+        }
+    }
+
+    for (uint32_t i = 0; t_writer->m_levels != NULL && i < t_writer->m_level_count; i++) {
+        free(t_writer->m_levels[i].m_band);
+    }
+    free(t_writer->m_levels);
+    free(t_writer->m_directory);
+    free(t_writer->m_path);
+
+    return complete ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,57 @@
+#ifndef MANDELBROT_DZI_WRITER_H
+#define MANDELBROT_DZI_WRITER_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdatomic.h>
+#include "thread_pool.h"
+
+// pixels in both directions of a tile of a pyramid, tiles do not overlap
+#define DZI_TILE_SIZE 256
+
+/** Level of a pyramid, of which one row of tiles is held at a time. */
+typedef struct {
+    uint32_t m_width;
+    uint32_t m_height;
+    /** Rows of the current row of tiles, up to {DZI_TILE_SIZE} rows of {m_width} RGB pixels. */
+    uint8_t *m_band;
+    uint32_t m_band_rows;
+    /** Index of the current row of tiles. */
+    uint32_t m_tile_row;
+} dzi_level_t;
+
+/**
+ * Writes an image row by row as a Deep Zoom pyramid of png tiles, so that neither the image nor any of its levels
+ * has to be in memory as a whole. Only the finest level is given, every coarser level halves the one above it
+ * down to a single pixel. Once a row of tiles of a level is complete, its tiles are written and it is
+ * downsampled into the level below, both by the workers of the pool. */
+typedef struct {
+    /** Directory of the tiles, the path of the descriptor with _files instead of .dzi. */
+    char *m_directory;
+    /** Path of the descriptor, written once all tiles are. */
+    char *m_path;
+    /** Level i is 2^(i - {m_level_count} + 1) of the size of the image, rounded up. */
+    dzi_level_t *m_levels;
+    uint32_t m_level_count;
+    uint64_t m_tile_count;
+    thread_pool_t *m_pool;
+    /** Set once writing a tile failed, after which nothing is written anymore. */
+    atomic_bool m_failed;
+} dzi_writer_t;
+
+/**
+ * Creates the directories of a pyramid of an image of {t_width} by {t_height} pixels, described by {t_path}
+ * which ends in .dzi. Call to {delete_dzi_writer} is required if {EXIT_SUCCESS} is returned. */
+int create_dzi_writer(
+        dzi_writer_t *t_writer, const char *t_path, uint32_t t_width, uint32_t t_height, thread_pool_t *t_pool
+);
+
+/** Adds {t_count} RGB rows of {t_pixels} to the finest level, writing the tiles that are complete. */
+int dzi_writer_write_rows(dzi_writer_t *t_writer, const uint8_t *t_pixels, uint32_t t_count);
+
+/**
+ * Writes the descriptor and frees the writer. Returns {EXIT_FAILURE} if not all rows were given or writing failed,
+ * in which case the pyramid is incomplete. */
+int delete_dzi_writer(dzi_writer_t *t_writer);
+
+#endif //MANDELBROT_DZI_WRITER_H
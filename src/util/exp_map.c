@@ -0,0 +1,335 @@
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "exp_map.h"
+#include "mandelbrot.h"
+#include "log.h"
+
+// smallest number of columns of a level, so that the coarsest levels still resolve a circle
+#define MIN_COLUMNS 64
+// number of samples a worker computes at a time
+#define ROW_TASK_SAMPLES 16384
+// number of rows of a frame a worker resamples at a time
+#define FRAME_TASK_ROWS 16
+
+/** Rows of a level computed by a worker. */
+typedef struct {
+    const exp_map_t *m_map;
+    const exp_map_level_t *m_level;
+    uint64_t m_row;
+    uint32_t m_row_count;
+    float *m_out;
+    // z, its difference to the reference orbit and c of a row, 4 x {m_columns} per worker and for the thread
+    // that queues the rows, and the index into the reference orbit of every column
+    double *m_scratch;
+    uint32_t *m_ref_index;
+} row_task_t;
+
+/** Rows of a frame resampled by a worker. */
+typedef struct {
+    const exp_map_t *m_map;
+    float *m_frame;
+    uint32_t m_width;
+    uint32_t m_height;
+    uint32_t m_y0, m_y1;
+    double m_spacing;
+    // radius of the corners of the frame
+    double m_radius;
+    const float *m_inner;
+    double m_inner_spacing;
+    double m_inner_radius;
+} frame_task_t;
+
+int create_exp_map(
+        exp_map_t *p_map, hp_t re_center, hp_t im_center, double radius, uint32_t columns, uint32_t level_count,
+        uint32_t max_iterations
+)
+{
+    p_map->m_radius = radius;
+    p_map->m_re_center = hp_to_double(re_center);
+    p_map->m_im_center = hp_to_double(im_center);
+    p_map->m_max_iterations = max_iterations;
+    p_map->m_sample_count = 0;
+    p_map->m_level_count = 0;
+    if (create_reference_orbit(&p_map->m_orbit, re_center, im_center) == EXIT_FAILURE) return EXIT_FAILURE;
+    // an orbit that could not grow is logged and only costs accuracy, see {extend_reference_orbit}
+    extend_reference_orbit(&p_map->m_orbit, max_iterations);
+
+    if ((p_map->m_levels = calloc(level_count, sizeof(exp_map_level_t))) == NULL) {
+        nm_log(LOG_ERROR, "could not allocate memory for %u levels of exp map\n", level_count);
+        delete_reference_orbit(&p_map->m_orbit);
+
+        return EXIT_FAILURE;
+    }
+    p_map->m_level_count = level_count;
+    for (uint32_t j = 0; j < level_count; j++) {
+        exp_map_level_t *level = &p_map->m_levels[j];
+        level->m_columns = columns >> j > MIN_COLUMNS ? columns >> j : MIN_COLUMNS;
+        level->m_step = 2. * M_PI / level->m_columns;
+        level->m_cos = malloc(sizeof(double) * level->m_columns);
+        level->m_sin = malloc(sizeof(double) * level->m_columns);
+        if (level->m_cos == NULL || level->m_sin == NULL) {
+            nm_log(LOG_ERROR, "could not allocate memory for %u columns of exp map\n", level->m_columns);
+            delete_exp_map(p_map);
+
+            return EXIT_FAILURE;
+        }
+        for (uint32_t i = 0; i < level->m_columns; i++) {
+            level->m_cos[i] = cos(i * level->m_step);
+            level->m_sin[i] = sin(i * level->m_step);
+        }
+    }
+
+    return EXIT_SUCCESS;
+}
+
+void delete_exp_map(exp_map_t *p_map)
+{
+    for (uint32_t j = 0; j < p_map->m_level_count; j++) {
+        free(p_map->m_levels[j].m_rows);
+        free(p_map->m_levels[j].m_sin);
+        free(p_map->m_levels[j].m_cos);
+    }
+    free(p_map->m_levels);
+    delete_reference_orbit(&p_map->m_orbit);
+}
+
+/** Continuous row of {level} at {radius}, zero for the radius of the map and larger ones. */
+static double row_of(const exp_map_t *p_map, const exp_map_level_t *p_level, double radius)
+{
+    double row = log(p_map->m_radius / radius) / p_level->m_step;
+
+    return row > 0. ? row : 0.;
+}
+
+static void compute_rows(void *p_arg, uint32_t p_worker)
+{
+    row_task_t *task = p_arg;
+    const exp_map_level_t *level = task->m_level;
+    uint32_t n = level->m_columns;
+    const exp_map_t *map = task->m_map;
+    uint32_t max_iterations = map->m_max_iterations;
+    // like {generate}, rows with samples far enough apart for doubles skip the reference orbit
+    double magnitude = fmax(1., fmax(fabs(map->m_re_center), fabs(map->m_im_center)));
+
+    double *dr = &task->m_scratch[(size_t) p_worker * 4 * n];
+    double *di = &dr[n];
+    double *dcr = &di[n];
+    double *dci = &dcr[n];
+    uint32_t *ref_index = &task->m_ref_index[(size_t) p_worker * n];
+    for (uint32_t r = 0; r < task->m_row_count; r++) {
+        double radius = map->m_radius * exp(-(double) (task->m_row + r) * level->m_step);
+        bool direct = radius * level->m_step >= DOUBLE_DOUBLE_SPACING * magnitude;
+        for (uint32_t i = 0; i < n; i++) {
+            dcr[i] = radius * level->m_cos[i];
+            dci[i] = radius * level->m_sin[i];
+            if (direct) {
+                dcr[i] += map->m_re_center;
+                dci[i] += map->m_im_center;
+            }
+            // every sample starts at z = 0, which is also the difference to Z_0 = 0
+            dr[i] = 0.;
+            di[i] = 0.;
+            ref_index[i] = 0;
+        }
+
+        float *out = &task->m_out[(size_t) r * n];
+        if (direct) {
+            mandelbrot_span(out, dr, di, dcr, dci, n, 0, max_iterations, true);
+        } else {
+            perturbation_span(out, dr, di, dcr, dci, ref_index, n, 0, max_iterations, &map->m_orbit);
+        }
+        for (uint32_t i = 0; i < n; i++) {
+            // samples that did not escape or were proven to cycle are counted as interior
+            if (out[i] < 0.f || isinf(out[i])) out[i] = (float) max_iterations;
+        }
+    }
+}
+
+/**
+ * Makes sure level {j} holds the rows between radius {outer} and {inner}, and the rows next to them for
+ * interpolation. Drops the rows outside of {outer}, which are not needed by later frames either. Returns
+ * {EXIT_FAILURE} if the rows could not be allocated, in which case the rows that are held are kept. */
+static int prepare_level(exp_map_t *p_map, uint32_t j, double outer, double inner, thread_pool_t *p_pool)
+{
+    exp_map_level_t *level = &p_map->m_levels[j];
+    uint32_t n = level->m_columns;
+    double first_row = floor(row_of(p_map, level, outer)) - 1.;
+    uint64_t first = first_row > 0. ? (uint64_t) first_row : 0;
+    uint64_t last = (uint64_t) floor(row_of(p_map, level, inner)) + 2;
+
+    /** drop the rows before the first one */
+    if (first > level->m_first) {
+        uint64_t drop = first - level->m_first < level->m_count ? first - level->m_first : level->m_count;
+        level->m_count -= (uint32_t) drop;
+        memmove(level->m_rows, &level->m_rows[drop * n], sizeof(float) * level->m_count * n);
+        level->m_first = level->m_count > 0 ? level->m_first + drop : first;
+    }
+
+    /** compute the rows after the last one held */
+    uint64_t end = level->m_first + level->m_count;
+    if (last < end) return EXIT_SUCCESS;
+
+    uint32_t count = (uint32_t) (last + 1 - level->m_first);
+    if (count > level->m_capacity) {
+        float *rows = realloc(level->m_rows, sizeof(float) * count * n);
+        if (rows == NULL) {
+            nm_log(LOG_ERROR, "could not allocate memory for %u rows of exp map level %u\n", count, j);
+
+            return EXIT_FAILURE;
+        }
+        level->m_rows = rows;
+        level->m_capacity = count;
+    }
+
+    uint32_t rows_per_task = ROW_TASK_SAMPLES / n > 0 ? ROW_TASK_SAMPLES / n : 1;
+    uint32_t task_count = (uint32_t) ((last + 1 - end + rows_per_task - 1) / rows_per_task);
+    row_task_t *tasks = malloc(sizeof(row_task_t) * task_count);
+    size_t workers = (size_t) p_pool->m_num_workers + 1;
+    double *scratch = malloc(sizeof(double) * workers * 4 * n);
+    uint32_t *ref_index = malloc(sizeof(uint32_t) * workers * n);
+    if (tasks == NULL || scratch == NULL || ref_index == NULL) {
+        nm_log(LOG_ERROR, "could not allocate memory for tasks of exp map level %u\n", j);
+        free(ref_index);
+        free(scratch);
+        free(tasks);
+
+        return EXIT_FAILURE;
+    }
+    for (uint32_t t = 0; t < task_count; t++) {
+        uint64_t row = end + (uint64_t) t * rows_per_task;
+        tasks[t].m_map = p_map;
+        tasks[t].m_level = level;
+        tasks[t].m_row = row;
+        tasks[t].m_row_count = row + rows_per_task <= last + 1 ? rows_per_task : (uint32_t) (last + 1 - row);
+        tasks[t].m_out = &level->m_rows[(row - level->m_first) * n];
+        tasks[t].m_scratch = scratch;
+        tasks[t].m_ref_index = ref_index;
+        if (thread_pool_submit(p_pool, compute_rows, &tasks[t]) == EXIT_FAILURE) {
+            // rows that could not be queued are computed on this thread
+            compute_rows(&tasks[t], p_pool->m_num_workers);
+        }
+    }
+    thread_pool_wait(p_pool);
+    free(ref_index);
+    free(scratch);
+    free(tasks);
+
+    p_map->m_sample_count += (last + 1 - end) * n;
+    level->m_count = count;
+
+    return EXIT_SUCCESS;
+}
+
+/** Samples {p_frame} of {width} by {height} at ({x}, {y}) by bilinear interpolation, clamped to its edges. */
+static float sample_frame(const float *p_frame, uint32_t width, uint32_t height, double x, double y)
+{
+    x = fmin(fmax(x, 0.), width - 1.);
+    y = fmin(fmax(y, 0.), height - 1.);
+    uint32_t x0 = (uint32_t) x, y0 = (uint32_t) y;
+    uint32_t x1 = x0 + 1 < width ? x0 + 1 : x0, y1 = y0 + 1 < height ? y0 + 1 : y0;
+    float fx = (float) (x - x0), fy = (float) (y - y0);
+
+    float top = p_frame[y0 * width + x0] + fx * (p_frame[y0 * width + x1] - p_frame[y0 * width + x0]);
+    float bottom = p_frame[y1 * width + x0] + fx * (p_frame[y1 * width + x1] - p_frame[y1 * width + x0]);
+
+    return top + fy * (bottom - top);
+}
+
+/** Samples {p_level} at radius {radius} and angle {angle} in [-pi, pi] by bilinear interpolation. */
+static float sample_level(const exp_map_t *p_map, const exp_map_level_t *p_level, double radius, double angle)
+{
+    uint32_t n = p_level->m_columns;
+
+    // the rows next to the ones that are needed are held, so clamping only guards against rounding
+    double row = row_of(p_map, p_level, radius) - (double) p_level->m_first;
+    row = fmin(fmax(row, 0.), p_level->m_count - 1.);
+    uint32_t r0 = (uint32_t) row;
+    uint32_t r1 = r0 + 1 < p_level->m_count ? r0 + 1 : r0;
+    float fr = (float) (row - r0);
+
+    double column = (angle < 0. ? angle + 2. * M_PI : angle) / p_level->m_step;
+    uint32_t c0 = (uint32_t) column % n;
+    uint32_t c1 = (c0 + 1) % n;
+    float fc = (float) (column - floor(column));
+
+    const float *row0 = &p_level->m_rows[(size_t) r0 * n];
+    const float *row1 = &p_level->m_rows[(size_t) r1 * n];
+    float a = row0[c0] + fc * (row0[c1] - row0[c0]);
+    float b = row1[c0] + fc * (row1[c1] - row1[c0]);
+
+    return a + fr * (b - a);
+}
+
+static void render_rows(void *p_arg, uint32_t p_worker)
+{
+    frame_task_t *task = p_arg;
+    const exp_map_t *map = task->m_map;
+    uint32_t w = task->m_width;
+    uint32_t h = task->m_height;
+
+    for (uint32_t y = task->m_y0; y < task->m_y1; y++) {
+        for (uint32_t x = 0; x < w; x++) {
+            // pixels are placed like the samples of {generate}, at their corners
+            double dx = (x - w / 2.) * task->m_spacing;
+            double dy = (y - h / 2.) * task->m_spacing;
+            double radius = sqrt(dx * dx + dy * dy);
+
+            float value;
+            if (radius < task->m_inner_radius) {
+                value = sample_frame(
+                        task->m_inner, w, h, dx / task->m_inner_spacing + w / 2., dy / task->m_inner_spacing + h / 2.
+                );
+            } else {
+                // level j for a fraction of 2^-j to 2^-(j + 1) of the radius of the frame
+                double octave = floor(log2(task->m_radius / radius));
+                uint32_t j = octave < 0. ? 0 : (uint32_t) octave;
+                if (j >= map->m_level_count) j = map->m_level_count - 1;
+                value = sample_level(map, &map->m_levels[j], radius, atan2(dy, dx));
+            }
+            task->m_frame[y * w + x] = value;
+        }
+    }
+}
+
+int exp_map_render(
+        exp_map_t *p_map, float *p_frame, uint32_t width, uint32_t height, double spacing, const float *p_inner,
+        double inner_spacing, double inner_radius, thread_pool_t *p_pool
+)
+{
+    double radius = sqrt((double) width * width + (double) height * height) / 2. * spacing;
+
+    /** compute the rows every level is sampled at, the last level down to the inner frame */
+    for (uint32_t j = 0; j < p_map->m_level_count; j++) {
+        double outer = ldexp(radius, -(int) j);
+        double inner = j + 1 < p_map->m_level_count ? ldexp(radius, -(int) j - 1) : inner_radius;
+        if (outer < inner_radius) break;
+        if (prepare_level(p_map, j, outer, inner > inner_radius ? inner : inner_radius, p_pool) == EXIT_FAILURE) {
+            return EXIT_FAILURE;
+        }
+    }
+
+    /** resample */
+    uint32_t task_count = (height + FRAME_TASK_ROWS - 1) / FRAME_TASK_ROWS;
+    frame_task_t *tasks = malloc(sizeof(frame_task_t) * task_count);
+    if (tasks == NULL) {
+        nm_log(LOG_ERROR, "could not allocate memory for tasks of exp map frame\n");
+
+        return EXIT_FAILURE;
+    }
+    for (uint32_t t = 0; t < task_count; t++) {
+        tasks[t] = (frame_task_t) {
+                p_map, p_frame, width, height, t * FRAME_TASK_ROWS,
+                (t + 1) * FRAME_TASK_ROWS < height ? (t + 1) * FRAME_TASK_ROWS : height, spacing, radius, p_inner,
+                inner_spacing, inner_radius
+        };
+        if (thread_pool_submit(p_pool, render_rows, &tasks[t]) == EXIT_FAILURE) {
+            // rows that could not be queued are resampled on this thread
+            render_rows(&tasks[t], p_pool->m_num_workers);
+        }
+    }
+    thread_pool_wait(p_pool);
+    free(tasks);
+
+    return EXIT_SUCCESS;
+}
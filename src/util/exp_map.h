@@ -0,0 +1,70 @@
+#ifndef MANDELBROT_EXP_MAP_H
+#define MANDELBROT_EXP_MAP_H
+
+#include <stdint.h>
+#include "hp.h"
+#include "perturbation.h"
+#include "thread_pool.h"
+
+/**
+ * Rows of one level of an exponential map. Row k holds the samples at a radius of {m_radius} times e^(-k {m_step})
+ * around the center, at angles of i {m_step} for column i, so that a sample covers the same part of the circle
+ * as of the radius. Only a window of consecutive rows is kept. */
+typedef struct {
+    uint32_t m_columns;
+    double m_step;
+    // cosine and sine of the angle of every column
+    double *m_cos;
+    double *m_sin;
+
+    // rows {m_first} to {m_first} + {m_count} - 1, {m_columns} iteration counts each
+    float *m_rows;
+    uint64_t m_first;
+    uint32_t m_count;
+    uint32_t m_capacity;
+} exp_map_level_t;
+
+/**
+ * Exponential map of the iteration counts around a center, for rendering a zoom into that center. Every frame
+ * of the zoom is resampled from it, a frame at half the size reuses the same rows. Part of a frame at a radius
+ * of a fraction 2^-j of its own radius is sampled from level j, which has 2^-j of the columns of level 0, so
+ * that no level is much finer than the pixels it is sampled for. Rows that doubles resolve are iterated
+ * directly, deeper ones as differences to a reference orbit through the center, so that the center can be as
+ * deep as a view of {generate}. */
+typedef struct {
+    // radius of row 0 of every level
+    double m_radius;
+    // center rounded to doubles, for the rows that are iterated directly
+    double m_re_center;
+    double m_im_center;
+    uint32_t m_max_iterations;
+    ReferenceOrbit m_orbit;
+    exp_map_level_t *m_levels;
+    uint32_t m_level_count;
+    // number of samples computed for all levels together
+    uint64_t m_sample_count;
+} exp_map_t;
+
+/**
+ * Creates a map around {re_center} + {im_center}i, from radius {radius} inwards, with {columns} columns at
+ * level 0 and {level_count} levels. Call to {delete_exp_map} is required if {EXIT_SUCCESS} is returned. */
+int create_exp_map(
+        exp_map_t *p_map, hp_t re_center, hp_t im_center, double radius, uint32_t columns, uint32_t level_count,
+        uint32_t max_iterations
+);
+
+void delete_exp_map(exp_map_t *p_map);
+
+/**
+ * Resamples the frame of {width} by {height} pixels with a spacing of {spacing} between them, centered at the
+ * center of the map like the views of {generate}, into {p_frame}, with the interior counted as the maximum.
+ * Pixels closer to the center than {inner_radius} are taken from {p_inner}, a frame of the same size with a
+ * spacing of {inner_spacing}. Computes the rows that are needed and drops the ones that are no longer needed, so
+ * frames are given from the largest spacing to the smallest. Both are done by the workers of {p_pool}.
+ * Returns {EXIT_FAILURE} if the rows or the tasks could not be allocated, in which case {p_frame} is not written. */
+int exp_map_render(
+        exp_map_t *p_map, float *p_frame, uint32_t width, uint32_t height, double spacing, const float *p_inner,
+        double inner_spacing, double inner_radius, thread_pool_t *p_pool
+);
+
+#endif //MANDELBROT_EXP_MAP_H
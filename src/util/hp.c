@@ -0,0 +1,138 @@
+#include <math.h>
+#include <string.h>
+#include <stdlib.h>
+#include "hp.h"
+
+hp_t hp_from_double(double x)
+{
+    hp_t result;
+    double a = fabs(x);
+
+    // every limb takes the next 32 bits of the magnitude, a double runs out after at most three limbs
+    double integer = floor(a);
+    result.limb[0] = (uint32_t) integer;
+    double fraction = a - integer;
+    for (uint32_t i = 1; i < HP_LIMBS; i++) {
+        fraction = ldexp(fraction, 32);
+        double limb = floor(fraction);
+        result.limb[i] = (uint32_t) limb;
+        fraction -= limb;
+    }
+
+    return x < 0 ? hp_neg(result) : result;
+}
+
+int hp_from_string(const char *s, hp_t *result)
+{
+    bool negative = *s == '-';
+    if (*s == '-' || *s == '+') s++;
+
+    uint64_t integer = 0;
+    uint32_t digit_count = 0;
+    for (; *s >= '0' && *s <= '9'; s++, digit_count++) {
+        integer = integer * 10 + (*s - '0');
+        if (integer >= 0x80000000u) return EXIT_FAILURE;
+    }
+    const char *fraction = *s == '.' ? ++s : s;
+    for (; *s >= '0' && *s <= '9'; s++, digit_count++);
+    if (*s != '\0' || digit_count == 0) return EXIT_FAILURE;
+
+    // from the last digit to the first, the digit is placed in the integer limb and the number divided by ten
+    memset(result, 0, sizeof(hp_t));
+    for (const char *digit = s; digit-- > fraction;) {
+        result->limb[0] = (uint32_t) (*digit - '0');
+        uint64_t remainder = 0;
+        for (uint32_t i = 0; i < HP_LIMBS; i++) {
+            uint64_t value = (remainder << 32) | result->limb[i];
+            result->limb[i] = (uint32_t) (value / 10);
+            remainder = value % 10;
+        }
+    }
+    result->limb[0] = (uint32_t) integer;
+
+    if (negative) *result = hp_neg(*result);
+
+    return EXIT_SUCCESS;
+}
+
+double hp_to_double(hp_t x)
+{
+    bool negative = hp_is_negative(x);
+    hp_t a = negative ? hp_neg(x) : x;
+
+    // three limbs from the first nonzero one hold more bits than the mantissa of a double
+    uint32_t first = 0;
+    while (first < HP_LIMBS - 1 && a.limb[first] == 0) first++;
+    double result = 0;
+    for (uint32_t i = first; i < first + 3 && i < HP_LIMBS; i++) {
+        result += ldexp((double) a.limb[i], -32 * (int) i);
+    }
+
+    return negative ? -result : result;
+}
+
+hp_t hp_add(hp_t x, hp_t y)
+{
+    hp_t result;
+    uint64_t carry = 0;
+    for (uint32_t i = HP_LIMBS; i-- > 0;) {
+        uint64_t sum = (uint64_t) x.limb[i] + y.limb[i] + carry;
+        result.limb[i] = (uint32_t) sum;
+        carry = sum >> 32;
+    }
+
+    return result;
+}
+
+hp_t hp_sub(hp_t x, hp_t y)
+{
+    return hp_add(x, hp_neg(y));
+}
+
+hp_t hp_neg(hp_t x)
+{
+    // invert all bits and add one unit in the last place
+    hp_t result;
+    uint64_t carry = 1;
+    for (uint32_t i = HP_LIMBS; i-- > 0;) {
+        uint64_t sum = (uint64_t) (uint32_t) ~x.limb[i] + carry;
+        result.limb[i] = (uint32_t) sum;
+        carry = sum >> 32;
+    }
+
+    return result;
+}
+
+hp_t hp_mul(hp_t x, hp_t y)
+{
+    bool negative = hp_is_negative(x) != hp_is_negative(y);
+    hp_t a = hp_is_negative(x) ? hp_neg(x) : x;
+    hp_t b = hp_is_negative(y) ? hp_neg(y) : y;
+
+    // schoolbook multiplication of the magnitudes, limb HP_LIMBS - 1 + k of the product is limb k of the
+    // result when counted from the least significant end
+    uint32_t product[2 * HP_LIMBS];
+    memset(product, 0, sizeof(product));
+    for (uint32_t i = 0; i < HP_LIMBS; i++) {
+        uint64_t carry = 0;
+        uint32_t ai = a.limb[HP_LIMBS - 1 - i];
+        for (uint32_t j = 0; j < HP_LIMBS; j++) {
+            uint64_t t = (uint64_t) ai * b.limb[HP_LIMBS - 1 - j] + product[i + j] + carry;
+            product[i + j] = (uint32_t) t;
+            carry = t >> 32;
+        }
+        product[i + HP_LIMBS] = (uint32_t) carry;
+    }
+
+    hp_t result;
+    for (uint32_t k = 0; k < HP_LIMBS; k++) {
+        result.limb[HP_LIMBS - 1 - k] = product[HP_LIMBS - 1 + k];
+    }
+
+    return negative ? hp_neg(result) : result;
+}
+
+bool hp_is_negative(hp_t x)
+{
+    return (x.limb[0] & 0x80000000u) != 0;
+}
@@ -0,0 +1,41 @@
+#ifndef MANDELBROT_HP_H
+#define MANDELBROT_HP_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// number of 32-bit limbs of a high precision number, one integer limb and the remaining limbs fraction
+#define HP_LIMBS 16
+
+/**
+ * High precision fixed-point number in two's complement. Limb 0 holds the integer part as a signed value,
+ * limbs 1 to {HP_LIMBS} - 1 hold the fraction, most significant first. Represents values in [-2^31, 2^31)
+ * with a resolution of 2^(-32 * ({HP_LIMBS} - 1)), about 1e-144. */
+typedef struct {
+    uint32_t limb[HP_LIMBS];
+} hp_t;
+
+/** Converts a double in [-2^31, 2^31), exactly. */
+hp_t hp_from_double(double x);
+
+/**
+ * Converts a decimal number of the form [-]digits[.digits] in (-2^31, 2^31) into {result}, with any number of
+ * fractional digits, so that coordinates deeper than a double can be given. Bits beyond the resolution are
+ * truncated. Returns {EXIT_FAILURE} if {s} is not such a number. */
+int hp_from_string(const char *s, hp_t *result);
+
+/** Converts to a double, bits beyond the precision of a double are truncated. */
+double hp_to_double(hp_t x);
+
+hp_t hp_add(hp_t x, hp_t y);
+
+hp_t hp_sub(hp_t x, hp_t y);
+
+hp_t hp_neg(hp_t x);
+
+/** Multiplication, the result is truncated to the resolution and wraps around if it is out of range. */
+hp_t hp_mul(hp_t x, hp_t y);
+
+bool hp_is_negative(hp_t x);
+
+#endif //MANDELBROT_HP_H
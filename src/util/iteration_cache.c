@@ -0,0 +1,113 @@
+#include <stdlib.h>
+#include <string.h>
+#include "iteration_cache.h"
+#include "log.h"
+
+void create_iteration_cache(iteration_cache_t *t_cache, size_t t_budget)
+{
+    memset(t_cache, 0, sizeof(iteration_cache_t));
+    t_cache->m_budget = t_budget;
+}
+
+void delete_iteration_cache(iteration_cache_t *t_cache)
+{
+    iteration_cache_clear(t_cache);
+    free(t_cache->m_entries);
+}
+
+/** Deletes the entry at {t_index}, moving the last entry into its place. */
+static void remove_entry(iteration_cache_t *t_cache, uint32_t t_index)
+{
+    iteration_cache_entry_t *entry = &t_cache->m_entries[t_index];
+    t_cache->m_size -= entry->m_size;
+    delete_iteration_state(&entry->m_state);
+    *entry = t_cache->m_entries[--t_cache->m_count];
+}
+
+/** Returns the index of the entry of {t_level}, or {m_count} if there is none. */
+static uint32_t find_entry(const iteration_cache_t *t_cache, uint32_t t_level)
+{
+    uint32_t i = 0;
+    while (i < t_cache->m_count && t_cache->m_entries[i].m_level != t_level) i++;
+    return i;
+}
+
+void iteration_cache_store(iteration_cache_t *t_cache, uint32_t t_level, IterationState *t_state)
+{
+    size_t size = iteration_state_size(t_state);
+
+    uint32_t index = find_entry(t_cache, t_level);
+    if (index < t_cache->m_count) {
+        remove_entry(t_cache, index);
+    }
+
+    if (size > t_cache->m_budget) {
+        nm_log(LOG_WARN, "iteration state of %zu bytes exceeds the cache budget\n", size);
+        delete_iteration_state(t_state);
+        create_iteration_state(t_state);
+        return;
+    }
+
+    // evict the least recently used entries until the state fits
+    while (t_cache->m_size + size > t_cache->m_budget) {
+        uint32_t oldest = 0;
+        for (uint32_t i = 1; i < t_cache->m_count; i++) {
+            if (t_cache->m_entries[i].m_last_used < t_cache->m_entries[oldest].m_last_used) oldest = i;
+        }
+        nm_log(LOG_TRACE, "evicting level %u from the iteration cache\n", t_cache->m_entries[oldest].m_level);
+        remove_entry(t_cache, oldest);
+    }
+
+    if (t_cache->m_count == t_cache->m_capacity) {
+        uint32_t capacity = t_cache->m_capacity == 0 ? 16 : t_cache->m_capacity * 2;
+        iteration_cache_entry_t *entries = realloc(t_cache->m_entries, sizeof(iteration_cache_entry_t) * capacity);
+        if (entries == NULL) {
+            // the state is dropped as if it exceeded the budget, the view is computed again when it is returned to
+            nm_log(LOG_ERROR, "could not grow iteration cache\n");
+            delete_iteration_state(t_state);
+            create_iteration_state(t_state);
+            return;
+        }
+        t_cache->m_entries = entries;
+        t_cache->m_capacity = capacity;
+    }
+
+    iteration_cache_entry_t *entry = &t_cache->m_entries[t_cache->m_count++];
+    entry->m_level = t_level;
+    entry->m_last_used = t_cache->m_clock++;
+    entry->m_size = size;
+    entry->m_state = *t_state;
+    t_cache->m_size += size;
+    create_iteration_state(t_state);
+
+    nm_log(
+            LOG_INFO, "iteration cache holds %u levels in %.1f of %.1f MiB\n", t_cache->m_count,
+            t_cache->m_size / (1024. * 1024.), t_cache->m_budget / (1024. * 1024.)
+    );
+}
+
+bool iteration_cache_take(iteration_cache_t *t_cache, uint32_t t_level, Fractal t_fractal, IterationState *t_state)
+{
+    uint32_t index = find_entry(t_cache, t_level);
+    if (index == t_cache->m_count) return false;
+
+    iteration_cache_entry_t *entry = &t_cache->m_entries[index];
+    if (!fractal_equal(entry->m_state.fractal, t_fractal)) {
+        // the stack was changed at this level since the state was stored
+        remove_entry(t_cache, index);
+        return false;
+    }
+
+    *t_state = entry->m_state;
+    t_cache->m_size -= entry->m_size;
+    *entry = t_cache->m_entries[--t_cache->m_count];
+
+    return true;
+}
+
+void iteration_cache_clear(iteration_cache_t *t_cache)
+{
+    while (t_cache->m_count > 0) {
+        remove_entry(t_cache, t_cache->m_count - 1);
+    }
+}
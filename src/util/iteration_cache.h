@@ -0,0 +1,51 @@
+#ifndef MANDELBROT_ITERATION_CACHE_H
+#define MANDELBROT_ITERATION_CACHE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "mandelbrot.h"
+
+typedef struct {
+    /** Level of the fractal stack the state was computed for. */
+    uint32_t m_level;
+    /** Value of {m_clock} when the entry was stored, the smallest is evicted first. */
+    uint64_t m_last_used;
+    /** Bytes held by {m_state}. */
+    size_t m_size;
+    IterationState m_state;
+} iteration_cache_entry_t;
+
+/** Iteration states of views that are no longer shown, kept so that returning to a view resumes it. */
+typedef struct {
+    iteration_cache_entry_t *m_entries;
+    uint32_t m_count;
+    uint32_t m_capacity;
+    /** Bytes the states may hold together. */
+    size_t m_budget;
+    /** Bytes the states hold together, at most {m_budget}. */
+    size_t m_size;
+    uint64_t m_clock;
+} iteration_cache_t;
+
+/** Creates an empty cache, call to {delete_iteration_cache} is required. */
+void create_iteration_cache(iteration_cache_t *t_cache, size_t t_budget);
+
+/** Deletes the cache and all states in it. */
+void delete_iteration_cache(iteration_cache_t *t_cache);
+
+/**
+ * Takes ownership of {t_state} as the state of level {t_level}, replacing the entry of that level.
+ * Least recently stored entries are deleted until it fits the budget, a state larger than the budget is
+ * deleted right away. Leaves an empty state in {t_state}. */
+void iteration_cache_store(iteration_cache_t *t_cache, uint32_t t_level, IterationState *t_state);
+
+/**
+ * If the entry of level {t_level} holds {t_fractal}, moves its state into {t_state} which must be empty, and
+ * returns true. An entry of that level for another view is stale and deleted. */
+bool iteration_cache_take(iteration_cache_t *t_cache, uint32_t t_level, Fractal t_fractal, IterationState *t_state);
+
+/** Deletes all states, for when the size of the views changes. */
+void iteration_cache_clear(iteration_cache_t *t_cache);
+
+#endif //MANDELBROT_ITERATION_CACHE_H
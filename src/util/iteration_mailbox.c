@@ -0,0 +1,118 @@
+#include <stdlib.h>
+#include <string.h>
+#include "iteration_mailbox.h"
+#include "log.h"
+
+// set in {m_middle} if the buffer was published and not taken yet
+#define FRESH_FLAG 4u
+#define INDEX_MASK 3u
+
+/**
+ * Changes the size of {t_buffer}, the contents are undefined afterwards. On failure the buffer keeps its
+ * size and contents. */
+static int resize_buffer(IterationBuffer *t_buffer, uint32_t t_width, uint32_t t_height)
+{
+    // the contents are not kept, so there is nothing to gain from realloc
+    float *data = malloc(sizeof(float) * t_width * t_height);
+    uint32_t *tile_versions = malloc(sizeof(uint32_t) * iteration_tile_count(t_width) * iteration_tile_count(t_height));
+    if (data == NULL || tile_versions == NULL) {
+        nm_log(LOG_ERROR, "could not allocate memory for iteration buffer of %ux%u\n", t_width, t_height);
+        free(tile_versions);
+        free(data);
+
+        return EXIT_FAILURE;
+    }
+
+    free(t_buffer->tile_versions);
+    free(t_buffer->data);
+    t_buffer->data = data;
+    t_buffer->tile_versions = tile_versions;
+    t_buffer->width = t_width;
+    t_buffer->height = t_height;
+
+    return EXIT_SUCCESS;
+}
+
+int create_iteration_mailbox(iteration_mailbox_t *t_mailbox, uint32_t t_width, uint32_t t_height)
+{
+    memset(t_mailbox, 0, sizeof(iteration_mailbox_t));
+    for (uint32_t i = 0; i < MAILBOX_BUFFER_COUNT; i++) {
+        if (resize_buffer(&t_mailbox->m_buffers[i], t_width, t_height) == EXIT_FAILURE) {
+            delete_iteration_mailbox(t_mailbox);
+
+            return EXIT_FAILURE;
+        }
+    }
+
+    t_mailbox->m_back = 0;
+    t_mailbox->m_front = 1;
+    atomic_init(&t_mailbox->m_middle, 2);
+
+    // the consumer starts out at sequence zero, so every tile of the first buffer is new
+    return iteration_mailbox_resize(t_mailbox, t_width, t_height);
+}
+
+void delete_iteration_mailbox(iteration_mailbox_t *t_mailbox)
+{
+    for (uint32_t i = 0; i < MAILBOX_BUFFER_COUNT; i++) {
+        free(t_mailbox->m_buffers[i].tile_versions);
+        free(t_mailbox->m_buffers[i].data);
+    }
+}
+
+IterationBuffer *iteration_mailbox_back(iteration_mailbox_t *t_mailbox)
+{
+    return &t_mailbox->m_buffers[t_mailbox->m_back];
+}
+
+int iteration_mailbox_resize(iteration_mailbox_t *t_mailbox, uint32_t t_width, uint32_t t_height)
+{
+    IterationBuffer *back = iteration_mailbox_back(t_mailbox);
+    if ((back->width != t_width || back->height != t_height) &&
+        resize_buffer(back, t_width, t_height) == EXIT_FAILURE) {
+        return EXIT_FAILURE;
+    }
+
+    if (back->sequence == 0) back->sequence = 1;
+    uint32_t tile_count = iteration_tile_count(t_width) * iteration_tile_count(t_height);
+    for (uint32_t i = 0; i < tile_count; i++) {
+        back->tile_versions[i] = back->sequence;
+    }
+
+    return EXIT_SUCCESS;
+}
+
+IterationBuffer *iteration_mailbox_publish(iteration_mailbox_t *t_mailbox)
+{
+    uint32_t published = t_mailbox->m_back;
+
+    // releases the writes to the published buffer, and acquires the reads of the consumer from the returned one
+    t_mailbox->m_back = atomic_exchange(&t_mailbox->m_middle, published | FRESH_FLAG) & INDEX_MASK;
+
+    /** continue from a copy of the published buffer, which no thread writes to while it is copied */
+    IterationBuffer *source = &t_mailbox->m_buffers[published];
+    IterationBuffer *back = iteration_mailbox_back(t_mailbox);
+    back->sequence = source->sequence + 1;
+    if (back->width != source->width || back->height != source->height) {
+        // returned at its previous size, which the producer resizes before it writes into it again
+        if (resize_buffer(back, source->width, source->height) == EXIT_FAILURE) return back;
+    }
+    memcpy(back->data, source->data, sizeof(float) * source->width * source->height);
+    memcpy(
+            back->tile_versions, source->tile_versions,
+            sizeof(uint32_t) * iteration_tile_count(source->width) * iteration_tile_count(source->height)
+    );
+    back->max_iterations = source->max_iterations;
+
+    return back;
+}
+
+const IterationBuffer *iteration_mailbox_take(iteration_mailbox_t *t_mailbox)
+{
+    if ((atomic_load(&t_mailbox->m_middle) & FRESH_FLAG) == 0) return NULL;
+
+    // only the consumer clears the flag, so the buffer in the middle is still fresh and is swapped for the front
+    t_mailbox->m_front = atomic_exchange(&t_mailbox->m_middle, t_mailbox->m_front) & INDEX_MASK;
+
+    return &t_mailbox->m_buffers[t_mailbox->m_front];
+}
@@ -0,0 +1,54 @@
+#ifndef MANDELBROT_ITERATION_MAILBOX_H
+#define MANDELBROT_ITERATION_MAILBOX_H
+
+#include <stdint.h>
+#include <stdatomic.h>
+#include "mandelbrot.h"
+
+/** Number of buffers of a mailbox: one written, one read and one in between. */
+#define MAILBOX_BUFFER_COUNT 3
+
+/**
+ * Hands iteration buffers from a producer thread to a consumer thread, without either one waiting for the
+ * other or taking a lock. The producer writes one buffer and the consumer reads another, the third holds the
+ * newest published buffer. Publishing and taking swap a buffer with the third by an atomic exchange of its
+ * index, so the consumer always takes the newest buffer and skips older ones it did not get to. */
+typedef struct {
+    IterationBuffer m_buffers[MAILBOX_BUFFER_COUNT];
+    /** Index of the buffer written by the producer, only accessed by the producer. */
+    uint32_t m_back;
+    /** Index of the buffer read by the consumer, only accessed by the consumer. */
+    uint32_t m_front;
+    /** Index of the newest published buffer, with a flag set if the consumer has not taken it yet. */
+    atomic_uint m_middle;
+} iteration_mailbox_t;
+
+/**
+ * Creates a mailbox of buffers of {t_width} by {t_height}. Call to {delete_iteration_mailbox} is required if
+ * {EXIT_SUCCESS} is returned. */
+int create_iteration_mailbox(iteration_mailbox_t *t_mailbox, uint32_t t_width, uint32_t t_height);
+
+/** Deletes the mailbox, after neither thread uses it anymore. */
+void delete_iteration_mailbox(iteration_mailbox_t *t_mailbox);
+
+/** Returns the buffer the producer writes into. */
+IterationBuffer *iteration_mailbox_back(iteration_mailbox_t *t_mailbox);
+
+/**
+ * Changes the size of the buffer the producer writes into, which marks all its tiles as changed. On failure
+ * the buffer keeps its size. */
+int iteration_mailbox_resize(iteration_mailbox_t *t_mailbox, uint32_t t_width, uint32_t t_height);
+
+/**
+ * Publishes the buffer the producer wrote into and returns the next one, which holds a copy of the published
+ * buffer with the next sequence number, so that changes keep being tracked against what was published. If the
+ * next buffer could not be given the size of the published one, it is returned at its previous size. */
+IterationBuffer *iteration_mailbox_publish(iteration_mailbox_t *t_mailbox);
+
+/**
+ * Returns the newest published buffer if it was not taken yet, NULL otherwise. The buffer stays valid and
+ * unchanged until the next call. Its tiles changed since the last taken buffer are those with a version
+ * larger than the sequence number of that buffer. */
+const IterationBuffer *iteration_mailbox_take(iteration_mailbox_t *t_mailbox);
+
+#endif //MANDELBROT_ITERATION_MAILBOX_H
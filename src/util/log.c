@@ -31,6 +31,11 @@ void nm_log_level(log_level_t p_level)
     m_level = p_level;
 }
 
+void nm_log_stream(FILE *p_stream)
+{
+    m_log_stream = p_stream;
+}
+
 void nm_log(log_level_t t_level, const char *t_format, ...)
 {
     if (t_level >= m_level) {
@@ -38,10 +43,11 @@ void nm_log(log_level_t t_level, const char *t_format, ...)
             pthread_mutex_lock(&m_log_mutex);
         }
 
-        fprintf(stdout, "%s ", LEVEL_NAMES[t_level]);
+        FILE *stream = m_log_stream != NULL ? m_log_stream : stdout;
+        fprintf(stream, "%s ", LEVEL_NAMES[t_level]);
         va_list argptr;
         va_start(argptr, t_format);
-        vfprintf(stdout, t_format, argptr);
+        vfprintf(stream, t_format, argptr);
         va_end(argptr);
 
         if (m_thread_safe) {
@@ -4,6 +4,7 @@
 
 #include <stdbool.h>
 #include <stdint.h>
+#include <stdio.h>
 #include <pthread.h>
 
 typedef enum {
@@ -20,6 +21,7 @@ static const char *LEVEL_NAMES[] = {
 log_level_t m_level;
 bool m_thread_safe;
 pthread_mutex_t m_log_mutex;
+FILE *m_log_stream;
 
 /**
  * Call to {nm_log_cleanup} is required if {EXIT_SUCCESS} is returned.
@@ -31,6 +33,9 @@ void nm_log_cleanup();
 /** Set the log level. */
 void nm_log_level(log_level_t p_level);
 
+/** Set the stream to log to, stdout by default. */
+void nm_log_stream(FILE *p_stream);
+
 /** Log with a specified level. */
 void nm_log(log_level_t t_level, const char *t_format, ...);
 
@@ -1,110 +1,1191 @@
 #include <stdint.h>
 #include <string.h>
+#include <stdlib.h>
 #include <malloc.h>
 #include "complex.h"
 #include "mandelbrot.h"
 #include "math.h"
 #include "nm_math.h"
+#include "mandelbrot_simd.h"
+#include "log.h"
 
-color_t color(float m, const float *const hues, uint32_t max_iterations)
+// number of active samples iterated by a single task
+#define ACTIVE_CHUNK_SIZE 4096
+// number of iterations after which a task checks for cancellation
+#define ITERATION_SLICE 1024
+// width and height in samples of the rectangles a frame starts with when subdividing
+#define SUBDIVISION_TILE_SIZE 64
+// rectangles with a side of at most this many samples are evaluated entirely instead of being split
+#define SUBDIVISION_MIN_SIZE 4
+// distance between the samples of the coarsest level of a progressive view, halved every level
+#define PROGRESSIVE_STRIDE 4
+// maximum number of iterations of the coarse levels of a progressive view, the full level continues them
+#define PROGRESSIVE_MAX_ITERATIONS 256
+
+// kernel used by {mandelbrot_span}, selected by {init_mandelbrot}
+static void (*span_kernel)(
+        float *, double *, double *, const double *, const double *, uint32_t, uint32_t, uint32_t, bool
+) = mandelbrot_span_scalar;
+
+// kernel used by {perturbation_span}, selected by {init_mandelbrot}
+static uint32_t (*perturbation_kernel)(
+        float *, double *, double *, const double *, const double *, uint32_t *, uint32_t, uint32_t, uint32_t,
+        const ReferenceOrbit *
+) = perturbation_span_scalar;
+
+// kernel used by {dd_span}, selected by {init_mandelbrot}
+static void (*dd_kernel)(
+        float *, double *, double *, double *, double *, const double *, const double *, const double *,
+        const double *, uint32_t, uint32_t, uint32_t
+) = dd_span_scalar;
+
+// kernel used by {colorize}, selected by {init_mandelbrot}
+static void (*colorize_kernel)(uint32_t *, const float *, uint32_t, const uint32_t *) = colorize_scalar;
+
+// see {set_interior_checks}
+static bool cardioid_check = true;
+static bool periodicity_check = true;
+
+// see {set_subdivision}
+static bool subdivision = false;
+
+// see {set_adaptive_supersampling}
+static bool adaptive_supersampling = false;
+static float adaptive_threshold = 1.f;
+
+void init_mandelbrot()
+{
+    if (mandelbrot_has_avx512()) {
+        span_kernel = mandelbrot_span_avx512;
+        perturbation_kernel = perturbation_span_avx512;
+        dd_kernel = dd_span_avx512;
+        colorize_kernel = colorize_avx512;
+        nm_log(LOG_INFO, "using AVX-512 mandelbrot kernel\n");
+    } else if (mandelbrot_has_avx2()) {
+        span_kernel = mandelbrot_span_avx2;
+        perturbation_kernel = perturbation_span_avx2;
+        dd_kernel = dd_span_avx2;
+        colorize_kernel = colorize_avx2;
+        nm_log(LOG_INFO, "using AVX2 mandelbrot kernel\n");
+    } else {
+        span_kernel = mandelbrot_span_scalar;
+        perturbation_kernel = perturbation_span_scalar;
+        dd_kernel = dd_span_scalar;
+        colorize_kernel = colorize_scalar;
+        nm_log(LOG_INFO, "using scalar mandelbrot kernel\n");
+    }
+}
+
+void set_interior_checks(bool p_cardioid, bool p_periodicity)
 {
-    float hue_lo = hues[(uint32_t) floorf(m)];
-    float hue_hi = hues[(uint32_t) ceilf(m)];
+    cardioid_check = p_cardioid;
+    periodicity_check = p_periodicity;
+}
 
-    color_t hsv;
-    hsv.h = 255 - (uint32_t) (255 * nm_lerpf(hue_lo, hue_hi, fmodf(m, 1)));
-    hsv.s = 255;
-    hsv.v = m < max_iterations ? 255 : 0;
-    color_t rgb = HSVtoRGB(hsv);
+void set_subdivision(bool p_enabled)
+{
+    subdivision = p_enabled;
+}
 
-    return rgb;
+void set_adaptive_supersampling(bool p_enabled, float p_threshold)
+{
+    adaptive_supersampling = p_enabled;
+    adaptive_threshold = p_threshold;
 }
 
-float mandelbrot(complex_t c, uint32_t max_iterations)
+/** Whether a view with the given samples per pixel is supersampled adaptively, see {set_adaptive_supersampling}. */
+static bool use_adaptive_supersampling(uint32_t SPP_X, uint32_t SPP_Y)
 {
-    complex_t z = {0, 0};
-    uint32_t n = 0;
+    return adaptive_supersampling && !subdivision && SPP_X * SPP_Y > 1;
+}
 
-    while (complex_abs(z) <= 2 && n < max_iterations) {
-        z = complex_add(complex_mul_self(z), c);
-        n++;
+bool in_cardioid_or_bulb(double cr, double ci)
+{
+    // main cardioid, q(q + (x - 1/4)) <= y^2 / 4 with q = (x - 1/4)^2 + y^2
+    double ci2 = ci * ci;
+    double q = (cr - .25) * (cr - .25) + ci2;
+    if (q * (q + (cr - .25)) <= .25 * ci2) {
+        return true;
     }
 
+    // period-2 bulb, the disk with radius 1/4 around -1
+    return (cr + 1.) * (cr + 1.) + ci2 <= .0625;
+}
+
+double fractal_re_size(Fractal p_fractal)
+{
+    return ldexp(p_fractal.re_size, p_fractal.scale);
+}
+
+double fractal_im_size(Fractal p_fractal)
+{
+    return ldexp(p_fractal.im_size, p_fractal.scale);
+}
+
+bool fractal_equal(Fractal p_a, Fractal p_b)
+{
+    // compared field by field, the padding after {scale} is not initialized
+    return memcmp(p_a.re_center.limb, p_b.re_center.limb, sizeof(p_a.re_center.limb)) == 0 &&
+           memcmp(p_a.im_center.limb, p_b.im_center.limb, sizeof(p_a.im_center.limb)) == 0 &&
+           p_a.re_size == p_b.re_size && p_a.im_size == p_b.im_size && p_a.scale == p_b.scale;
+}
+
+Fractal zoom_fractal(Fractal p_fractal, double re_offset, double im_offset, double re_factor, double im_factor)
+{
+    // the offset is small compared to the current size, which is representable by a double
+    Fractal result = {
+            .re_center = hp_add(p_fractal.re_center, hp_from_double(re_offset * fractal_re_size(p_fractal))),
+            .im_center = hp_add(p_fractal.im_center, hp_from_double(im_offset * fractal_im_size(p_fractal))),
+            .re_size = p_fractal.re_size * re_factor,
+            .im_size = p_fractal.im_size * im_factor,
+            .scale = p_fractal.scale,
+    };
+
+    // move the exponent of the width into the scale, the height shares it to keep the aspect ratio exact
+    int exponent;
+    frexp(result.re_size, &exponent);
+    result.re_size = ldexp(result.re_size, 1 - exponent);
+    result.im_size = ldexp(result.im_size, 1 - exponent);
+    result.scale += exponent - 1;
+
+    return result;
+}
+
+void colorize_scalar(uint32_t *p_pixels, const float *p_iterations, uint32_t count, const uint32_t *p_lut)
+{
+    for (uint32_t i = 0; i < count; i++) {
+        p_pixels[i] = p_lut[(uint32_t) (p_iterations[i] * (float) PALETTE_STEPS)];
+    }
+}
+
+void colorize(uint32_t *p_pixels, const float *p_iterations, uint32_t count, const uint32_t *p_lut)
+{
+    colorize_kernel(p_pixels, p_iterations, count, p_lut);
+}
+
+float mandelbrot_smooth(uint32_t n, double abs_sq, uint32_t max_iterations)
+{
     if (n == max_iterations) {
         return max_iterations;
     }
 
     // fractional iteration count (http://linas.org/art-gallery/escape/escape.html)
-    return nm_clampf(0, max_iterations, (float) n + 1.f - logf(log2f((float) complex_abs(z))));
+    // log2(|z|) is computed as log2(|z|^2) / 2 to avoid the square root
+    return nm_clampf(0, max_iterations, (float) n + 1.f - logf(.5f * log2f((float) abs_sq)));
+}
+
+float mandelbrot(complex_t c, uint32_t max_iterations)
+{
+    if (cardioid_check && in_cardioid_or_bulb(c.a, c.b)) {
+        return max_iterations;
+    }
+
+    double zr = 0, zi = 0;
+    double zr2 = 0, zi2 = 0;
+    uint32_t n = 0;
+    // value of z saved for periodicity detection, and the iteration at which it is saved next
+    double check_r = 0, check_i = 0;
+    uint32_t check_at = 1;
+
+    // compare the squared magnitude against the squared bailout radius
+    while (zr2 + zi2 <= 4 && n < max_iterations) {
+        zi = 2 * zr * zi + c.b;
+        zr = zr2 - zi2 + c.a;
+        zr2 = zr * zr;
+        zi2 = zi * zi;
+        n++;
+
+        if (periodicity_check) {
+            double dr = zr - check_r, di = zi - check_i;
+            if (dr * dr + di * di < PERIODICITY_TOLERANCE) {
+                return max_iterations;
+            }
+            if (n == check_at) {
+                check_r = zr;
+                check_i = zi;
+                check_at *= 2;
+            }
+        }
+    }
+
+    return mandelbrot_smooth(n, zr2 + zi2, max_iterations);
+}
+
+void mandelbrot_span_scalar(
+        float *p_out, double *p_zr, double *p_zi, const double *p_cr, const double *p_ci, uint32_t count,
+        uint32_t n_start, uint32_t n_end, bool periodicity
+)
+{
+    for (uint32_t i = 0; i < count; i++) {
+        double zr = p_zr[i], zi = p_zi[i];
+        double zr2 = zr * zr, zi2 = zi * zi;
+        uint32_t n = n_start;
+        // value of z saved for periodicity detection, and the number of iterations at which it is saved next
+        double check_r = zr, check_i = zi;
+        uint32_t check_at = 1;
+        bool interior = false;
+
+        while (zr2 + zi2 <= 4 && n < n_end) {
+            zi = 2 * zr * zi + p_ci[i];
+            zr = zr2 - zi2 + p_cr[i];
+            zr2 = zr * zr;
+            zi2 = zi * zi;
+            n++;
+
+            if (periodicity) {
+                double dr = zr - check_r, di = zi - check_i;
+                if (dr * dr + di * di < PERIODICITY_TOLERANCE) {
+                    interior = true;
+                    break;
+                }
+                if (n - n_start == check_at) {
+                    check_r = zr;
+                    check_i = zi;
+                    check_at *= 2;
+                }
+            }
+        }
+
+        p_zr[i] = zr;
+        p_zi[i] = zi;
+        if (interior) {
+            p_out[i] = INFINITY;
+        } else {
+            p_out[i] = n == n_end ? -1.f : mandelbrot_smooth(n, zr2 + zi2, n_end);
+        }
+    }
+}
+
+void mandelbrot_span(
+        float *p_out, double *p_zr, double *p_zi, const double *p_cr, const double *p_ci, uint32_t count,
+        uint32_t n_start, uint32_t n_end, bool periodicity
+)
+{
+    span_kernel(p_out, p_zr, p_zi, p_cr, p_ci, count, n_start, n_end, periodicity);
+}
+
+uint32_t perturbation_span(
+        float *p_out, double *p_dr, double *p_di, const double *p_dcr, const double *p_dci, uint32_t *p_ref_index,
+        uint32_t count, uint32_t n_start, uint32_t n_end, const ReferenceOrbit *p_orbit
+)
+{
+    return perturbation_kernel(p_out, p_dr, p_di, p_dcr, p_dci, p_ref_index, count, n_start, n_end, p_orbit);
+}
+
+void dd_span(
+        float *p_out, double *p_zr, double *p_zr_lo, double *p_zi, double *p_zi_lo,
+        const double *p_cr, const double *p_cr_lo, const double *p_ci, const double *p_ci_lo,
+        uint32_t count, uint32_t n_start, uint32_t n_end
+)
+{
+    dd_kernel(p_out, p_zr, p_zr_lo, p_zi, p_zi_lo, p_cr, p_cr_lo, p_ci, p_ci_lo, count, n_start, n_end);
+}
+
+void create_iteration_state(IterationState *p_state)
+{
+    memset(p_state, 0, sizeof(IterationState));
+}
+
+void delete_iteration_state(IterationState *p_state)
+{
+    if (p_state->kernel == KERNEL_PERTURBATION) {
+        delete_reference_orbit(&p_state->orbit);
+    }
+    p_state->kernel = KERNEL_DOUBLE;
+    free(p_state->ci_lo);
+    free(p_state->cr_lo);
+    free(p_state->zi_lo);
+    free(p_state->zr_lo);
+    free(p_state->rects);
+    free(p_state->ref_index);
+    free(p_state->ci);
+    free(p_state->cr);
+    free(p_state->zi);
+    free(p_state->zr);
+    free(p_state->active_index);
+    free(p_state->evaluated);
+    free(p_state->samples);
+}
+
+bool iteration_state_converged(const IterationState *p_state)
+{
+    if (p_state->active_count == 0 || p_state->max_iterations >= MAX_ITER_LIMIT) return true;
+
+    return p_state->escaped_total > p_state->escaped &&
+           p_state->escaped < CONVERGED_FRACTION * p_state->sample_count;
+}
+
+uint32_t next_max_iterations(uint32_t p_max_iterations)
+{
+    uint32_t next = (uint32_t) (p_max_iterations * ITER_GROWTH);
+
+    return next < MAX_ITER_LIMIT ? next : MAX_ITER_LIMIT;
+}
+
+uint32_t iteration_tile_count(uint32_t p_size)
+{
+    return (p_size + ITERATION_TILE_SIZE - 1) / ITERATION_TILE_SIZE;
+}
+
+size_t iteration_state_size(const IterationState *p_state)
+{
+    // samples, evaluated flags, active indices, z, c and reference indices
+    size_t per_sample = sizeof(float) + sizeof(bool) + 2 * sizeof(uint32_t) + 4 * sizeof(double);
+    if (p_state->zr_lo != NULL) {
+        per_sample += 4 * sizeof(double);
+    }
+
+    size_t size = per_sample * p_state->sample_count + sizeof(sample_rect_t) * p_state->rect_capacity;
+    if (p_state->kernel == KERNEL_PERTURBATION) {
+        size += 2 * sizeof(double) * p_state->orbit.capacity;
+    }
+
+    return size;
+}
+
+/** Coordinates of the samples of the view an iteration state belongs to. */
+typedef struct {
+    uint32_t m_samples_x;
+    uint32_t m_samples_y;
+    double m_re_size, m_im_size;
+    double m_re_step;
+    // corner of the view, relative to the center for {KERNEL_PERTURBATION}
+    double m_re_start, m_im_start;
+    // center of the view for {KERNEL_DOUBLE_DOUBLE}
+    dd_t m_re_center, m_im_center;
+    // whether samples in the main cardioid or period-2 bulb are marked interior without iterating, only
+    // for views in doubles since the test itself is done in doubles
+    bool m_cardioid;
+} sample_grid_t;
+
+static sample_grid_t sample_grid(const IterationState *p_state)
+{
+    sample_grid_t grid;
+    grid.m_samples_x = p_state->width * p_state->spp_x;
+    grid.m_samples_y = p_state->height * p_state->spp_y;
+    grid.m_re_size = fractal_re_size(p_state->fractal);
+    grid.m_im_size = fractal_im_size(p_state->fractal);
+    grid.m_re_step = grid.m_re_size / grid.m_samples_x;
+
+    double re_center = 0., im_center = 0.;
+    if (p_state->kernel != KERNEL_PERTURBATION) {
+        re_center = hp_to_double(p_state->fractal.re_center);
+        im_center = hp_to_double(p_state->fractal.im_center);
+    }
+    grid.m_re_start = re_center - grid.m_re_size / 2;
+    grid.m_im_start = im_center - grid.m_im_size / 2;
+
+    grid.m_re_center = dd_from_hp(p_state->fractal.re_center);
+    grid.m_im_center = dd_from_hp(p_state->fractal.im_center);
+    grid.m_cardioid = cardioid_check && p_state->kernel == KERNEL_DOUBLE;
+
+    return grid;
+}
+
+/**
+ * Appends sample {p_index} to the active list with z = 0, or stores it as interior if it lies in the main
+ * cardioid or period-2 bulb. */
+static void admit_sample(IterationState *p_state, const sample_grid_t *p_grid, uint32_t p_index)
+{
+    uint32_t sx = p_index % p_grid->m_samples_x;
+    uint32_t sy = p_index / p_grid->m_samples_x;
+    p_state->evaluated[p_index] = true;
+
+    // convert sample coordinate to complex number
+    double im_offset = (p_grid->m_im_size * (double) sy) / p_grid->m_samples_y;
+    double cr = p_grid->m_re_start + p_grid->m_re_step * sx;
+    double ci = p_grid->m_im_start + im_offset;
+    if (p_grid->m_cardioid && in_cardioid_or_bulb(cr, ci)) {
+        p_state->samples[p_index] = INFINITY;
+        return;
+    }
+
+    uint32_t i = p_state->active_count++;
+    p_state->samples[p_index] = 0.f;
+    p_state->active_index[i] = p_index;
+    p_state->zr[i] = 0.;
+    p_state->zi[i] = 0.;
+    p_state->ref_index[i] = 0;
+    if (p_state->kernel == KERNEL_DOUBLE_DOUBLE) {
+        // add the offset to the center in double-double, as a double it would be rounded away
+        dd_t re = dd_add_double(p_grid->m_re_center, p_grid->m_re_step * sx - p_grid->m_re_size / 2);
+        dd_t im = dd_add_double(p_grid->m_im_center, im_offset - p_grid->m_im_size / 2);
+        p_state->zr_lo[i] = 0.;
+        p_state->zi_lo[i] = 0.;
+        p_state->cr[i] = re.hi;
+        p_state->cr_lo[i] = re.lo;
+        p_state->ci[i] = im.hi;
+        p_state->ci_lo[i] = im.lo;
+    } else {
+        p_state->cr[i] = cr;
+        p_state->ci[i] = ci;
+    }
+}
+
+/** Appends {p_rect} to a list of rectangles, growing it if needed. The list is left as is on failure. */
+static int push_rect(sample_rect_t **p_rects, uint32_t *p_count, uint32_t *p_capacity, sample_rect_t p_rect)
+{
+    if (*p_count == *p_capacity) {
+        uint32_t capacity = *p_capacity == 0 ? 64 : 2 * *p_capacity;
+        sample_rect_t *rects = realloc(*p_rects, sizeof(sample_rect_t) * capacity);
+        if (rects == NULL) {
+            nm_log(LOG_ERROR, "could not grow list of rectangles\n");
+
+            return EXIT_FAILURE;
+        }
+        *p_rects = rects;
+        *p_capacity = capacity;
+    }
+    (*p_rects)[(*p_count)++] = p_rect;
+
+    return EXIT_SUCCESS;
+}
+
+/** Admits every sample inside the border of {p_rect} that has not been evaluated yet. */
+static void admit_interior(IterationState *p_state, const sample_grid_t *p_grid, sample_rect_t p_rect)
+{
+    uint32_t samples_x = p_grid->m_samples_x;
+    for (uint32_t y = p_rect.y0 + 1; y < p_rect.y1; y++) {
+        for (uint32_t x = p_rect.x0 + 1; x < p_rect.x1; x++) {
+            if (!p_state->evaluated[y * samples_x + x]) {
+                admit_sample(p_state, p_grid, y * samples_x + x);
+            }
+        }
+    }
+}
+
+/** Number of samples on the border of {p_rect}. */
+static uint32_t border_count(sample_rect_t p_rect)
+{
+    uint32_t w = p_rect.x1 - p_rect.x0 + 1;
+    uint32_t h = p_rect.y1 - p_rect.y0 + 1;
+    if (w == 1 || h == 1) {
+        return w * h;
+    }
+
+    return 2 * w + 2 * (h - 2);
+}
+
+/** Index of the {k}th sample on the border of {p_rect}: the top row, the bottom row and then both sides. */
+static uint32_t border_index(sample_rect_t p_rect, uint32_t k, uint32_t samples_x)
+{
+    uint32_t w = p_rect.x1 - p_rect.x0 + 1;
+    uint32_t h = p_rect.y1 - p_rect.y0 + 1;
+    if (h == 1) {
+        return p_rect.y0 * samples_x + p_rect.x0 + k;
+    }
+    if (w == 1) {
+        return (p_rect.y0 + k) * samples_x + p_rect.x0;
+    }
+
+    if (k < w) {
+        return p_rect.y0 * samples_x + p_rect.x0 + k;
+    }
+    if (k < 2 * w) {
+        return p_rect.y1 * samples_x + p_rect.x0 + k - w;
+    }
+    uint32_t j = k - 2 * w;
+    return (p_rect.y0 + 1 + j / 2) * samples_x + (j % 2 ? p_rect.x1 : p_rect.x0);
+}
+
+/** Admits the samples on the border of {p_rect} that have not been evaluated yet. */
+static void admit_border(IterationState *p_state, const sample_grid_t *p_grid, sample_rect_t p_rect)
+{
+    uint32_t count = border_count(p_rect);
+    for (uint32_t k = 0; k < count; k++) {
+        uint32_t index = border_index(p_rect, k, p_grid->m_samples_x);
+        if (!p_state->evaluated[index]) {
+            admit_sample(p_state, p_grid, index);
+        }
+    }
 }
 
-void generate(volatile Texture *p_texture, Fractal p_fractal, uint32_t p_max_iterations, uint32_t SPP_X, uint32_t SPP_Y)
+/**
+ * Examines a rectangle of which all border samples are iterated up to {p_max_iterations}. If the border is
+ * uniform, either all at the maximum or all with the same integer count, the inside is filled with the
+ * average of the border and the rectangle is added to the filled rectangles of {p_state}. Otherwise the
+ * inside is admitted if it is small, or the rectangle is split into four which are added to {p_next}. */
+static void subdivide_rect(
+        IterationState *p_state, const sample_grid_t *p_grid, sample_rect_t p_rect, uint32_t p_max_iterations,
+        sample_rect_t **p_next, uint32_t *p_next_count, uint32_t *p_next_capacity
+)
 {
-    float *all_iterations = malloc(sizeof(float) * p_texture->width * p_texture->height);
-    // histogram counting the frequencies of all values expect max
-    uint32_t *histogram = calloc(p_max_iterations, sizeof(uint32_t));
-    // number of pixels that have less iterations than max
-    uint32_t total = 0;
+    uint32_t samples_x = p_grid->m_samples_x;
+    if (p_rect.x1 - p_rect.x0 < 2 || p_rect.y1 - p_rect.y0 < 2) {
+        // all samples are on the border
+        return;
+    }
+
+    // interior and undecided samples are in one class, escaped samples are classified by integer count
+    uint32_t count = border_count(p_rect);
+    float first = p_state->samples[border_index(p_rect, 0, samples_x)];
+    float first_class = first < p_max_iterations ? floorf(first) : -1.f;
+    bool uniform = true;
+    float sum = 0.f;
+    for (uint32_t k = 0; k < count && uniform; k++) {
+        float value = p_state->samples[border_index(p_rect, k, samples_x)];
+        uniform = (value < p_max_iterations ? floorf(value) : -1.f) == first_class;
+        sum += fminf(value, (float) p_max_iterations);
+    }
+
+    if (uniform) {
+        // a filled rectangle that is not kept would not be examined again, so its inside is evaluated instead
+        if (push_rect(&p_state->rects, &p_state->rect_count, &p_state->rect_capacity, p_rect) == EXIT_FAILURE) {
+            admit_interior(p_state, p_grid, p_rect);
+            return;
+        }
+        float fill = sum / (float) count;
+        // samples evaluated by a coarser level of a progressive view keep their value
+        for (uint32_t y = p_rect.y0 + 1; y < p_rect.y1; y++) {
+            for (uint32_t x = p_rect.x0 + 1; x < p_rect.x1; x++) {
+                if (!p_state->evaluated[y * samples_x + x]) {
+                    p_state->samples[y * samples_x + x] = fill;
+                }
+            }
+        }
+    } else if (p_rect.x1 - p_rect.x0 <= SUBDIVISION_MIN_SIZE || p_rect.y1 - p_rect.y0 <= SUBDIVISION_MIN_SIZE) {
+        admit_interior(p_state, p_grid, p_rect);
+    } else {
+        // the four quarters share the middle row and column
+        uint32_t xm = (p_rect.x0 + p_rect.x1) / 2;
+        uint32_t ym = (p_rect.y0 + p_rect.y1) / 2;
+        sample_rect_t quarters[4] = {
+                {p_rect.x0, p_rect.y0, xm, ym},
+                {xm, p_rect.y0, p_rect.x1, ym},
+                {p_rect.x0, ym, xm, p_rect.y1},
+                {xm, ym, p_rect.x1, p_rect.y1},
+        };
+        for (uint32_t q = 0; q < 4; q++) {
+            if (push_rect(p_next, p_next_count, p_next_capacity, quarters[q]) == EXIT_FAILURE) {
+                // the quarters that were kept are then found to be evaluated entirely
+                admit_interior(p_state, p_grid, p_rect);
+                break;
+            }
+        }
+    }
+}
+
+/**
+ * Starts over with no sample evaluated, {generate} decides which samples to admit. With subdivision, the
+ * frame is split into tiles. Returns {EXIT_FAILURE} if there are more than {UINT32_MAX} samples or memory for
+ * them or the reference orbit could not be allocated, in which case the state is left empty. */
+static int reset_iteration_state(
+        IterationState *p_state, Fractal p_fractal, uint32_t p_width, uint32_t p_height, uint32_t SPP_X,
+        uint32_t SPP_Y
+)
+{
+    uint64_t samples_x = (uint64_t) p_width * SPP_X;
+    uint64_t samples_y = (uint64_t) p_height * SPP_Y;
+    if (samples_x > UINT32_MAX || samples_y > UINT32_MAX || samples_x * samples_y > UINT32_MAX) {
+        nm_log(
+                LOG_ERROR, "too many samples for %ux%u pixels of %ux%u samples\n", p_width, p_height, SPP_X, SPP_Y
+        );
+        delete_iteration_state(p_state);
+        create_iteration_state(p_state);
+
+        return EXIT_FAILURE;
+    }
+    uint32_t sample_count = (uint32_t) (samples_x * samples_y);
+
+    if (p_state->kernel == KERNEL_PERTURBATION) {
+        delete_reference_orbit(&p_state->orbit);
+    }
+    p_state->kernel = KERNEL_DOUBLE;
 
-    double SAMPLES_X = p_texture->width * SPP_X;
-    double SAMPLES_Y = p_texture->height * SPP_Y;
+    if (p_state->sample_count != sample_count) {
+        delete_iteration_state(p_state);
+        memset(p_state, 0, sizeof(IterationState));
+        p_state->samples = malloc(sizeof(float) * sample_count);
+        p_state->evaluated = malloc(sizeof(bool) * sample_count);
+        p_state->active_index = malloc(sizeof(uint32_t) * sample_count);
+        p_state->zr = malloc(sizeof(double) * sample_count);
+        p_state->zi = malloc(sizeof(double) * sample_count);
+        p_state->cr = malloc(sizeof(double) * sample_count);
+        p_state->ci = malloc(sizeof(double) * sample_count);
+        p_state->ref_index = malloc(sizeof(uint32_t) * sample_count);
+        if (p_state->samples == NULL || p_state->evaluated == NULL || p_state->active_index == NULL ||
+            p_state->zr == NULL || p_state->zi == NULL || p_state->cr == NULL || p_state->ci == NULL ||
+            p_state->ref_index == NULL) {
+            nm_log(LOG_ERROR, "could not allocate memory for %u samples\n", sample_count);
+            delete_iteration_state(p_state);
+            create_iteration_state(p_state);
 
-    double re_size = p_fractal.re_end - p_fractal.re_start;
-    double im_size = p_fractal.im_end - p_fractal.im_start;
+            return EXIT_FAILURE;
+        }
+        p_state->sample_count = sample_count;
+    }
+
+    p_state->fractal = p_fractal;
+    p_state->width = p_width;
+    p_state->height = p_height;
+    p_state->spp_x = SPP_X;
+    p_state->spp_y = SPP_Y;
+    p_state->subdivided = subdivision;
+    p_state->adaptive = use_adaptive_supersampling(SPP_X, SPP_Y);
+    p_state->max_iterations = 0;
+    p_state->cancelled = false;
+    p_state->escaped_total = 0;
+    p_state->active_count = 0;
+    p_state->new_start = 0;
+    p_state->rect_count = 0;
+
+    double re_step = fractal_re_size(p_fractal) / samples_x;
+    double re_center = hp_to_double(p_fractal.re_center);
+    double im_center = hp_to_double(p_fractal.im_center);
+
+    // pick the cheapest number representation that still resolves the samples
+    double magnitude = fmax(1., fmax(fabs(re_center), fabs(im_center)));
+    if (fabs(re_step) < DEEP_ZOOM_SPACING * magnitude) {
+        // store c relative to the center which is the reference point
+        if (create_reference_orbit(&p_state->orbit, p_fractal.re_center, p_fractal.im_center) == EXIT_FAILURE) {
+            delete_iteration_state(p_state);
+            create_iteration_state(p_state);
+
+            return EXIT_FAILURE;
+        }
+        p_state->kernel = KERNEL_PERTURBATION;
+    } else if (fabs(re_step) < DOUBLE_DOUBLE_SPACING * magnitude) {
+        p_state->kernel = KERNEL_DOUBLE_DOUBLE;
+        if (p_state->zr_lo == NULL) {
+            p_state->zr_lo = malloc(sizeof(double) * sample_count);
+            p_state->zi_lo = malloc(sizeof(double) * sample_count);
+            p_state->cr_lo = malloc(sizeof(double) * sample_count);
+            p_state->ci_lo = malloc(sizeof(double) * sample_count);
+            if (p_state->zr_lo == NULL || p_state->zi_lo == NULL || p_state->cr_lo == NULL ||
+                p_state->ci_lo == NULL) {
+                nm_log(LOG_ERROR, "could not allocate memory for the low parts of %u samples\n", sample_count);
+                delete_iteration_state(p_state);
+                create_iteration_state(p_state);
+
+                return EXIT_FAILURE;
+            }
+        }
+    }
+
+    memset(p_state->evaluated, 0, sizeof(bool) * sample_count);
+
+    if (p_state->subdivided) {
+        // neighbouring tiles share their border, the tiles are examined like rectangles that were filled
+        for (uint32_t y0 = 0; y0 == 0 || y0 + 1 < samples_y; y0 += SUBDIVISION_TILE_SIZE) {
+            for (uint32_t x0 = 0; x0 == 0 || x0 + 1 < samples_x; x0 += SUBDIVISION_TILE_SIZE) {
+                sample_rect_t rect = {
+                        x0, y0,
+                        x0 + SUBDIVISION_TILE_SIZE < samples_x ? x0 + SUBDIVISION_TILE_SIZE : samples_x - 1,
+                        y0 + SUBDIVISION_TILE_SIZE < samples_y ? y0 + SUBDIVISION_TILE_SIZE : samples_y - 1
+                };
+                if (push_rect(&p_state->rects, &p_state->rect_count, &p_state->rect_capacity, rect) == EXIT_FAILURE) {
+                    // without its tiles the view is evaluated entirely, the next pass starts over and tries again
+                    p_state->subdivided = false;
+                    p_state->rect_count = 0;
+                    return EXIT_SUCCESS;
+                }
+            }
+        }
+    }
+
+    return EXIT_SUCCESS;
+}
+
+/** Admits every sample on a grid with {p_stride} samples between them that has not been evaluated yet. */
+static void admit_grid(IterationState *p_state, uint32_t p_stride)
+{
+    sample_grid_t grid = sample_grid(p_state);
+    for (uint32_t sy = 0; sy < grid.m_samples_y; sy += p_stride) {
+        for (uint32_t sx = 0; sx < grid.m_samples_x; sx += p_stride) {
+            uint32_t index = sy * grid.m_samples_x + sx;
+            if (!p_state->evaluated[index]) {
+                admit_sample(p_state, &grid, index);
+            }
+        }
+    }
+}
+
+/** Admits the first sample of every pixel that has not been evaluated yet. */
+static void admit_pixels(IterationState *p_state)
+{
+    sample_grid_t grid = sample_grid(p_state);
+    for (uint32_t sy = 0; sy < grid.m_samples_y; sy += p_state->spp_y) {
+        for (uint32_t sx = 0; sx < grid.m_samples_x; sx += p_state->spp_x) {
+            uint32_t index = sy * grid.m_samples_x + sx;
+            if (!p_state->evaluated[index]) {
+                admit_sample(p_state, &grid, index);
+            }
+        }
+    }
+}
+
+/** Whether two samples iterated up to {p_max_iterations} differ by more than the adaptive threshold. */
+static bool samples_differ(float p_a, float p_b, uint32_t p_max_iterations)
+{
+    // interior and undecided samples only match each other
+    bool a_max = p_a >= p_max_iterations, b_max = p_b >= p_max_iterations;
+    if (a_max || b_max) {
+        return a_max != b_max;
+    }
+
+    return fabsf(p_a - p_b) > adaptive_threshold;
+}
+
+/**
+ * Admits the samples that have not been evaluated yet of every pixel of which the first sample differs from
+ * the first sample of a horizontal or vertical neighbour. Returns the number of samples admitted. */
+static uint32_t refine_pixels(IterationState *p_state, const sample_grid_t *p_grid, uint32_t p_max_iterations)
+{
+    uint32_t samples_x = p_grid->m_samples_x;
+    uint32_t spp_x = p_state->spp_x, spp_y = p_state->spp_y;
+    uint32_t admitted = 0;
+
+    for (uint32_t y = 0; y < p_state->height; y++) {
+        for (uint32_t x = 0; x < p_state->width; x++) {
+            uint32_t index = y * spp_y * samples_x + x * spp_x;
+            float value = p_state->samples[index];
+            bool differs = (x > 0 && samples_differ(value, p_state->samples[index - spp_x], p_max_iterations)) ||
+                           (x + 1 < p_state->width &&
+                            samples_differ(value, p_state->samples[index + spp_x], p_max_iterations)) ||
+                           (y > 0 &&
+                            samples_differ(value, p_state->samples[index - spp_y * samples_x], p_max_iterations)) ||
+                           (y + 1 < p_state->height &&
+                            samples_differ(value, p_state->samples[index + spp_y * samples_x], p_max_iterations));
+            if (!differs) continue;
+
+            for (uint32_t yy = 0; yy < spp_y; yy++) {
+                for (uint32_t xx = 0; xx < spp_x; xx++) {
+                    if (!p_state->evaluated[index + yy * samples_x + xx]) {
+                        admit_sample(p_state, p_grid, index + yy * samples_x + xx);
+                        admitted++;
+                    }
+                }
+            }
+        }
+    }
+
+    return admitted;
+}
+
+/** Sets the samples that have not been evaluated of every pixel to the first sample of that pixel. */
+static void fill_pixels(IterationState *p_state, const sample_grid_t *p_grid)
+{
+    uint32_t samples_x = p_grid->m_samples_x;
+    for (uint32_t y = 0; y < p_state->height; y++) {
+        for (uint32_t x = 0; x < p_state->width; x++) {
+            uint32_t index = y * p_state->spp_y * samples_x + x * p_state->spp_x;
+            for (uint32_t yy = 0; yy < p_state->spp_y; yy++) {
+                for (uint32_t xx = 0; xx < p_state->spp_x; xx++) {
+                    if (!p_state->evaluated[index + yy * samples_x + xx]) {
+                        p_state->samples[index + yy * samples_x + xx] = p_state->samples[index];
+                    }
+                }
+            }
+        }
+    }
+}
+
+/** A consecutive range of the active list, iterated by a single worker. */
+typedef struct {
+    IterationState *m_state;
+    uint32_t m_start;
+    uint32_t m_count;
+    uint32_t m_n_start;
+    uint32_t m_n_end;
+    const atomic_bool *m_cancel;
+    // values of the range, per worker and for the thread that queues the chunks
+    float *m_scratch;
+    // number of samples in the range that did not escape, moved to the start of the range
+    uint32_t m_remaining;
+    // number of samples rebased onto the reference orbit
+    uint32_t m_rebases;
+    // number of samples in the range that escaped, not counting the ones proven to be interior
+    uint32_t m_escaped;
+} iterate_chunk_t;
+
+static bool is_cancelled(const atomic_bool *p_cancel)
+{
+    return p_cancel != NULL && atomic_load(p_cancel);
+}
+
+static void iterate_chunk(void *t_arg, uint32_t t_worker)
+{
+    iterate_chunk_t *chunk = t_arg;
+    IterationState *state = chunk->m_state;
+    float *out = &chunk->m_scratch[t_worker * ACTIVE_CHUNK_SIZE];
+    uint32_t start = chunk->m_start;
+    uint32_t count = chunk->m_count;
 
-    /** calculate iterations */
-    for (uint32_t y = 0; y < p_texture->height; y++) {
-        for (uint32_t x = 0; x < p_texture->width; x++) {
+    // iterate in slices to respond to cancellation, kernels continue where the previous slice stopped
+    chunk->m_rebases = 0;
+    chunk->m_escaped = 0;
+    for (uint32_t n_start = chunk->m_n_start; n_start < chunk->m_n_end && count > 0;) {
+        if (is_cancelled(chunk->m_cancel)) break;
+
+        uint32_t n_end = chunk->m_n_end - n_start > ITERATION_SLICE ? n_start + ITERATION_SLICE : chunk->m_n_end;
+        switch (state->kernel) {
+            case KERNEL_DOUBLE:
+                mandelbrot_span(
+                        out, &state->zr[start], &state->zi[start], &state->cr[start], &state->ci[start], count,
+                        n_start, n_end, periodicity_check
+                );
+                break;
+            case KERNEL_DOUBLE_DOUBLE:
+                dd_span(
+                        out, &state->zr[start], &state->zr_lo[start], &state->zi[start], &state->zi_lo[start],
+                        &state->cr[start], &state->cr_lo[start], &state->ci[start], &state->ci_lo[start],
+                        count, n_start, n_end
+                );
+                break;
+            case KERNEL_PERTURBATION:
+                chunk->m_rebases += perturbation_span(
+                        out, &state->zr[start], &state->zi[start], &state->cr[start], &state->ci[start],
+                        &state->ref_index[start], count, n_start, n_end, &state->orbit
+                );
+                break;
+        }
+
+        // store escaped and interior samples, and compact the samples that are still undecided
+        uint32_t remaining = 0;
+        for (uint32_t i = 0; i < count; i++) {
+            uint32_t index = state->active_index[start + i];
+            if (out[i] >= 0.f) {
+                state->samples[index] = out[i];
+                chunk->m_escaped += out[i] != INFINITY;
+            } else {
+                state->samples[index] = n_end;
+                uint32_t j = start + remaining++;
+                state->active_index[j] = index;
+                state->zr[j] = state->zr[start + i];
+                state->zi[j] = state->zi[start + i];
+                state->cr[j] = state->cr[start + i];
+                state->ci[j] = state->ci[start + i];
+                state->ref_index[j] = state->ref_index[start + i];
+                if (state->kernel == KERNEL_DOUBLE_DOUBLE) {
+                    state->zr_lo[j] = state->zr_lo[start + i];
+                    state->zi_lo[j] = state->zi_lo[start + i];
+                    state->cr_lo[j] = state->cr_lo[start + i];
+                    state->ci_lo[j] = state->ci_lo[start + i];
+                }
+            }
+        }
+        count = remaining;
+        n_start = n_end;
+    }
+    chunk->m_remaining = count;
+}
+
+/**
+ * Continues all active samples up to {p_max_iterations} and removes the ones that escaped from the list.
+ * Samples admitted since the last call start from zero, the others from {max_iterations}.
+ * Returns false if cancelled through {p_cancel}, which leaves the state unusable, or if memory for the chunks
+ * could not be allocated. */
+static bool iterate_active(
+        IterationState *p_state, uint32_t p_max_iterations, thread_pool_t *p_pool, const atomic_bool *p_cancel
+)
+{
+    if (p_state->kernel == KERNEL_PERTURBATION) {
+        // an orbit that could not grow is logged and only costs accuracy, see {extend_reference_orbit}
+        extend_reference_orbit(&p_state->orbit, p_max_iterations);
+    }
+
+    // the list consists of two segments, the first one is skipped if it is already at the maximum
+    uint32_t first = p_state->max_iterations == p_max_iterations ? p_state->new_start : 0;
+    uint32_t old_chunks = (p_state->new_start - first + ACTIVE_CHUNK_SIZE - 1) / ACTIVE_CHUNK_SIZE;
+    uint32_t new_chunks = (p_state->active_count - p_state->new_start + ACTIVE_CHUNK_SIZE - 1) / ACTIVE_CHUNK_SIZE;
+    uint32_t chunk_count = old_chunks + new_chunks;
+    iterate_chunk_t *chunks = malloc(sizeof(iterate_chunk_t) * chunk_count);
+    float *scratch = malloc(sizeof(float) * (p_pool->m_num_workers + 1) * ACTIVE_CHUNK_SIZE);
+    if (chunks == NULL || scratch == NULL) {
+        nm_log(LOG_ERROR, "could not allocate memory for %u chunks of samples\n", chunk_count);
+        free(scratch);
+        free(chunks);
+
+        return false;
+    }
+
+    for (uint32_t c = 0; c < chunk_count; c++) {
+        bool old = c < old_chunks;
+        uint32_t segment_start = old ? first : p_state->new_start;
+        uint32_t segment_end = old ? p_state->new_start : p_state->active_count;
+        uint32_t start = segment_start + (old ? c : c - old_chunks) * ACTIVE_CHUNK_SIZE;
+
+        chunks[c].m_state = p_state;
+        chunks[c].m_start = start;
+        chunks[c].m_count = start + ACTIVE_CHUNK_SIZE < segment_end ? ACTIVE_CHUNK_SIZE : segment_end - start;
+        chunks[c].m_n_start = old ? p_state->max_iterations : 0;
+        chunks[c].m_n_end = p_max_iterations;
+        chunks[c].m_cancel = p_cancel;
+        chunks[c].m_scratch = scratch;
+        if (thread_pool_submit(p_pool, iterate_chunk, &chunks[c]) == EXIT_FAILURE) {
+            // a chunk that could not be queued is iterated on this thread, with the scratch after the workers'
+            iterate_chunk(&chunks[c], p_pool->m_num_workers);
+        }
+    }
+    thread_pool_wait(p_pool);
+
+    if (is_cancelled(p_cancel)) {
+        free(scratch);
+        free(chunks);
+        return false;
+    }
+
+    // concatenate the compacted chunks
+    uint32_t active_count = first;
+    uint32_t rebases = 0;
+    for (uint32_t c = 0; c < chunk_count; c++) {
+        rebases += chunks[c].m_rebases;
+        p_state->escaped += chunks[c].m_escaped;
+        p_state->escaped_total += chunks[c].m_escaped;
+        uint32_t from = chunks[c].m_start, count = chunks[c].m_remaining;
+        if (from != active_count) {
+            memmove(&p_state->active_index[active_count], &p_state->active_index[from], sizeof(uint32_t) * count);
+            memmove(&p_state->zr[active_count], &p_state->zr[from], sizeof(double) * count);
+            memmove(&p_state->zi[active_count], &p_state->zi[from], sizeof(double) * count);
+            memmove(&p_state->cr[active_count], &p_state->cr[from], sizeof(double) * count);
+            memmove(&p_state->ci[active_count], &p_state->ci[from], sizeof(double) * count);
+            memmove(&p_state->ref_index[active_count], &p_state->ref_index[from], sizeof(uint32_t) * count);
+            if (p_state->kernel == KERNEL_DOUBLE_DOUBLE) {
+                memmove(&p_state->zr_lo[active_count], &p_state->zr_lo[from], sizeof(double) * count);
+                memmove(&p_state->zi_lo[active_count], &p_state->zi_lo[from], sizeof(double) * count);
+                memmove(&p_state->cr_lo[active_count], &p_state->cr_lo[from], sizeof(double) * count);
+                memmove(&p_state->ci_lo[active_count], &p_state->ci_lo[from], sizeof(double) * count);
+            }
+        }
+        active_count += count;
+    }
+
+    if (p_state->kernel == KERNEL_PERTURBATION) {
+        nm_log(
+                LOG_TRACE, "perturbation: reference orbit length=%u, rebased %u samples\n",
+                p_state->orbit.length, rebases
+        );
+    }
+
+    p_state->active_count = active_count;
+    p_state->new_start = active_count;
+    p_state->max_iterations = p_max_iterations;
+
+    free(scratch);
+    free(chunks);
+
+    return true;
+}
+
+/**
+ * Brings all samples up to {p_max_iterations}. With subdivision, the rectangles filled in the previous pass
+ * are examined again since their borders may no longer be uniform, which is repeated for the quarters of
+ * every rectangle that is split until all rectangles are either filled or evaluated entirely. With adaptive
+ * supersampling, pixels that differ from a neighbour are then evaluated entirely and the others are filled.
+ * Returns false if cancelled through {p_cancel}, or if memory to iterate could not be allocated. */
+static bool iterate_samples(
+        IterationState *p_state, uint32_t p_max_iterations, thread_pool_t *p_pool, const atomic_bool *p_cancel
+)
+{
+    sample_grid_t grid = sample_grid(p_state);
+
+    sample_rect_t *pending = p_state->rects;
+    uint32_t pending_count = p_state->rect_count;
+    p_state->rects = NULL;
+    p_state->rect_count = 0;
+    p_state->rect_capacity = 0;
+
+    while (true) {
+        for (uint32_t r = 0; r < pending_count; r++) {
+            admit_border(p_state, &grid, pending[r]);
+        }
+
+        if (!iterate_active(p_state, p_max_iterations, p_pool, p_cancel)) {
+            free(pending);
+            return false;
+        }
+        if (pending_count == 0) break;
+
+        sample_rect_t *next = NULL;
+        uint32_t next_count = 0, next_capacity = 0;
+        for (uint32_t r = 0; r < pending_count; r++) {
+            subdivide_rect(p_state, &grid, pending[r], p_max_iterations, &next, &next_count, &next_capacity);
+        }
+
+        free(pending);
+        pending = next;
+        pending_count = next_count;
+    }
+
+    free(pending);
+
+    // first samples are not changed by refining, so a single round finds all pixels that differ
+    if (p_state->adaptive) {
+        uint32_t admitted = refine_pixels(p_state, &grid, p_max_iterations);
+        if (admitted > 0 && !iterate_active(p_state, p_max_iterations, p_pool, p_cancel)) {
+            return false;
+        }
+        fill_pixels(p_state, &grid);
+        nm_log(LOG_TRACE, "adaptive supersampling: admitted %u samples\n", admitted);
+    }
+
+    return true;
+}
+
+/** State shared by all tiles of a single {render_iterations} call. */
+typedef struct {
+    const IterationState *m_state;
+    // every pixel takes its samples from a grid with this many samples between them
+    uint32_t m_stride;
+
+    // iterations of every pixel
+    float *m_iterations;
+    // version of every tile, or NULL, and the version of changed tiles
+    uint32_t *m_tile_versions;
+    uint32_t m_sequence;
+} generate_job_t;
+
+typedef struct {
+    generate_job_t *m_job;
+    uint32_t m_index; // index of the version
+    uint32_t m_x0, m_y0; // inclusive
+    uint32_t m_x1, m_y1; // exclusive
+} generate_tile_t;
+
+/** Averages the samples of every pixel in a tile. */
+static void generate_tile(void *t_arg, uint32_t t_worker)
+{
+    generate_tile_t *tile = t_arg;
+    generate_job_t *job = tile->m_job;
+    const IterationState *state = job->m_state;
+
+    uint32_t samples_x = state->width * state->spp_x;
+    bool changed = false;
+
+    for (uint32_t y = tile->m_y0; y < tile->m_y1; y++) {
+        for (uint32_t x = tile->m_x0; x < tile->m_x1; x++) {
             // the start coordinates of this pixel
-            uint32_t pixel_x = x * SPP_X;
-            uint32_t pixel_y = y * SPP_Y;
+            uint32_t pixel_x = x * state->spp_x;
+            uint32_t pixel_y = y * state->spp_y;
 
-            // compute the average of this pixel
+            // compute the average of this pixel, interior samples count as the maximum
             float avg_m = 0.f;
-            for (uint32_t yy = 0; yy < SPP_Y; yy++) {
-                for (uint32_t xx = 0; xx < SPP_X; xx++) {
-                    // convert pixel coordinate to complex number
-                    complex_t c = {
-                            p_fractal.re_start + (re_size * (double) (pixel_x + xx)) / SAMPLES_X,
-                            p_fractal.im_start + (im_size * (double) (pixel_y + yy)) / SAMPLES_Y,
-                    };
-
-                    // compute number of iterations
-                    avg_m += mandelbrot(c, p_max_iterations) / ((float) SPP_X * SPP_Y);
+            for (uint32_t yy = 0; yy < state->spp_y; yy++) {
+                for (uint32_t xx = 0; xx < state->spp_x; xx++) {
+                    uint32_t sx = (pixel_x + xx) / job->m_stride * job->m_stride;
+                    uint32_t sy = (pixel_y + yy) / job->m_stride * job->m_stride;
+                    float sample = state->samples[sy * samples_x + sx];
+                    avg_m += fminf(sample, (float) state->max_iterations) / ((float) state->spp_x * state->spp_y);
                 }
             }
 
-            all_iterations[y * p_texture->width + x] = avg_m;
+            changed |= job->m_iterations[y * state->width + x] != avg_m;
+            job->m_iterations[y * state->width + x] = avg_m;
+        }
+    }
+
+    if (changed && job->m_tile_versions != NULL) {
+        job->m_tile_versions[tile->m_index] = job->m_sequence;
+    }
+}
+
+/**
+ * Fills {p_buffer} from the samples of {p_state} on a grid with {p_stride} samples between them. Returns
+ * {EXIT_FAILURE} if memory for the tiles could not be allocated, in which case the buffer is not filled. */
+static int render_iterations(
+        volatile IterationBuffer *p_buffer, const IterationState *p_state, uint32_t p_max_iterations,
+        uint32_t p_stride, thread_pool_t *p_pool
+)
+{
+    generate_job_t job = {
+            .m_state = p_state,
+            .m_stride = p_stride,
+            .m_iterations = p_buffer->data,
+            .m_tile_versions = p_buffer->tile_versions,
+            .m_sequence = p_buffer->sequence,
+    };
+
+    /** average the samples of every pixel */
+    uint32_t tiles_x = iteration_tile_count(p_buffer->width);
+    uint32_t tiles_y = iteration_tile_count(p_buffer->height);
+    generate_tile_t *tiles = malloc(sizeof(generate_tile_t) * tiles_x * tiles_y);
+    if (tiles == NULL) {
+        nm_log(LOG_ERROR, "could not allocate memory for %ux%u tiles of iterations\n", tiles_x, tiles_y);
 
-            if (avg_m < p_max_iterations) {
-                histogram[(uint32_t) floorf(avg_m)]++;
-                total++;
+        return EXIT_FAILURE;
+    }
+    for (uint32_t ty = 0; ty < tiles_y; ty++) {
+        for (uint32_t tx = 0; tx < tiles_x; tx++) {
+            generate_tile_t *tile = &tiles[ty * tiles_x + tx];
+            tile->m_job = &job;
+            tile->m_index = ty * tiles_x + tx;
+            tile->m_x0 = tx * ITERATION_TILE_SIZE;
+            tile->m_y0 = ty * ITERATION_TILE_SIZE;
+            tile->m_x1 = tile->m_x0 + ITERATION_TILE_SIZE < p_buffer->width ?
+                         tile->m_x0 + ITERATION_TILE_SIZE : p_buffer->width;
+            tile->m_y1 = tile->m_y0 + ITERATION_TILE_SIZE < p_buffer->height ?
+                         tile->m_y0 + ITERATION_TILE_SIZE : p_buffer->height;
+            if (thread_pool_submit(p_pool, generate_tile, tile) == EXIT_FAILURE) {
+                // a tile that could not be queued is averaged on this thread
+                generate_tile(tile, p_pool->m_num_workers);
             }
         }
     }
+    thread_pool_wait(p_pool);
+    free(tiles);
 
-    /** construct a hue map for all possible values */
-    float *hues = malloc(sizeof(float) * (p_max_iterations + 1));
-    float h = 0;
-    for (uint32_t i = 0; i < p_max_iterations; i++) {
-        h += histogram[i] / (float) total;
-        hues[i] = h;
-    }
-    hues[p_max_iterations] = h;
-    free(histogram);
+    p_buffer->max_iterations = p_max_iterations;
 
-    /** lookup color and create pixel data */
-    uint32_t pixel_start = 0;
-    for (uint32_t y = 0; y < p_texture->height; y++) {
-        for (uint32_t x = 0; x < p_texture->width; x++) {
-            // create color, based on the number of iterations
-            color_t rgb = color(all_iterations[y * p_texture->width + x], hues, p_max_iterations);
-            memcpy(&p_texture->data[pixel_start], &rgb, sizeof(rgb));
-            p_texture->data[pixel_start + 3] = 255; // alpha value
-            pixel_start += sizeof(color_t) + 1;
+    return EXIT_SUCCESS;
+}
+
+int generate(
+        volatile IterationBuffer *p_buffer, IterationState *p_state, Fractal p_fractal, uint32_t p_max_iterations,
+        uint32_t SPP_X, uint32_t SPP_Y, thread_pool_t *p_pool, publish_fun_t p_publish, void *p_publish_arg,
+        const atomic_bool *p_cancel
+)
+{
+    /** continue from the previous pass if it was for the same view, otherwise start over */
+    bool reset = p_state->cancelled || !fractal_equal(p_state->fractal, p_fractal) ||
+                 p_state->width != p_buffer->width || p_state->height != p_buffer->height ||
+                 p_state->spp_x != SPP_X || p_state->spp_y != SPP_Y || p_state->subdivided != subdivision ||
+                 p_state->adaptive != use_adaptive_supersampling(SPP_X, SPP_Y) ||
+                 p_state->max_iterations > p_max_iterations;
+    p_state->escaped = 0;
+    if (reset) {
+        if (reset_iteration_state(p_state, p_fractal, p_buffer->width, p_buffer->height, SPP_X, SPP_Y) ==
+            EXIT_FAILURE) {
+            p_state->cancelled = true;
+            return EXIT_FAILURE;
         }
+
+        /** for a new view, first iterate a coarse grid of samples and publish it, the next level reuses them */
+        if (p_publish != NULL) {
+            // limited so that the time to the first result does not depend on the maximum
+            uint32_t max_iterations =
+                    p_max_iterations < PROGRESSIVE_MAX_ITERATIONS ? p_max_iterations : PROGRESSIVE_MAX_ITERATIONS;
+            // with subdivision only the coarsest level is used, all samples of a level are iterated to the
+            // maximum while subdivision would skip most of them
+            uint32_t last_stride = p_state->subdivided ? PROGRESSIVE_STRIDE : 2;
+            for (uint32_t stride = PROGRESSIVE_STRIDE; stride >= last_stride; stride /= 2) {
+                admit_grid(p_state, stride);
+                if (!iterate_active(p_state, max_iterations, p_pool, p_cancel) ||
+                    render_iterations(p_buffer, p_state, max_iterations, stride, p_pool) == EXIT_FAILURE) {
+                    p_state->cancelled = true;
+                    return EXIT_FAILURE;
+                }
+                p_buffer = p_publish(p_buffer, p_publish_arg);
+                // a buffer that could not be given the size of the view abandons the pass
+                if (p_buffer->width != p_state->width || p_buffer->height != p_state->height) {
+                    p_state->cancelled = true;
+                    return EXIT_FAILURE;
+                }
+            }
+        }
+
+        if (p_state->adaptive) {
+            admit_pixels(p_state);
+        } else if (!p_state->subdivided) {
+            admit_grid(p_state, 1);
+        }
+    }
+
+    /** calculate iterations, chunks are small enough for stealing to balance the uneven cost */
+    if (!iterate_samples(p_state, p_max_iterations, p_pool, p_cancel)) {
+        // samples are left in between two maximums, the next call starts over
+        p_state->cancelled = true;
+        return EXIT_FAILURE;
     }
 
-    free(hues);
-    free(all_iterations);
+    return render_iterations(p_buffer, p_state, p_max_iterations, 1, p_pool);
 }
\ No newline at end of file
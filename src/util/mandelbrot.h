@@ -2,42 +2,294 @@
 #define MANDELBROT_MANDELBROT_H
 
 #include <stdint.h>
-#include "color.h"
 #include "complex.h"
 #include "math.h"
+#include "thread_pool.h"
+#include "hp.h"
+#include "perturbation.h"
+#include "dd.h"
 
-// defines a fractal through coordinates
+// defines a fractal through the coordinates of its center and its size
 typedef struct Fractal {
-    double re_start;
-    double re_end;
-    double im_start;
-    double im_end;
+    // the center in high precision, so that it stays exact however deep the fractal is zoomed into
+    hp_t re_center;
+    hp_t im_center;
+    // the size is {re_size} and {im_size} times two to the power {scale}, see {fractal_re_size}
+    double re_size;
+    double im_size;
+    int32_t scale;
 } Fractal;
 
 // mandelbrot variables for defined RESOLUTION
 static const Fractal FRACTAL_START = {
-        -2.0, // RE_START
-        +1.0, // RE_END
-        -1.0, // IM_START
-        +1.0, // IM_END
+        {.limb = {0xffffffff, 0x80000000}}, // RE_CENTER (-0.5)
+        {.limb = {0}},                      // IM_CENTER (0)
+        1.5,                                // RE_SIZE (3.0)
+        1.0,                                // IM_SIZE (2.0)
+        1,                                  // SCALE
 };
 
+// spacing between samples, relative to the magnitude of the center, below which doubles no longer resolve
+// the samples and the double-double kernel is used
+static const double DOUBLE_DOUBLE_SPACING = 1e-12;
+
+// spacing between samples, relative to the magnitude of the center, below which double-doubles no longer
+// resolve the samples and the perturbation kernel is used
+static const double DEEP_ZOOM_SPACING = 1e-27;
+
+// squared distance below which z is considered to have returned to an earlier value, proving a cycle
+static const double PERIODICITY_TOLERANCE = 1e-30;
+
+// spacing between samples below which high precision numbers no longer resolve the samples
+static const double MIN_SPACING = 1e-130;
+
+// maximum number of iterations a view starts at, when it is raised until the view converges
+static const uint32_t INITIAL_MAX_ITER = 60;
+
+// factor the maximum number of iterations is multiplied by every pass, when it is raised until the view converges
+static const float ITER_GROWTH = 1.5f;
+
+// limit to the maximum number of iterations, up to which floats hold iteration counts exactly
+static const uint32_t MAX_ITER_LIMIT = 1u << 24;
+
+// fraction of the samples that escape in a pass below which raising the maximum no longer changes the view
+static const double CONVERGED_FRACTION = 1e-4;
+
+// width and height of the square tiles a frame is split into, and for which changes are tracked
+static const uint32_t ITERATION_TILE_SIZE = 32;
+
+// number of entries per iteration in the lookup table of {colorize}
+static const uint32_t PALETTE_STEPS = 64;
+
 typedef struct Texture {
     uint8_t *data;
     uint32_t width;
     uint32_t height;
 } Texture;
 
-/** Calculates a HSV color based on iterations. */
-color_t color(float m, const float *hues, uint32_t max_iterations);
+/** Iteration count of every pixel of a view, the product of {generate} from which a colorizer computes colors. */
+typedef struct IterationBuffer {
+    // average fractional count of the samples of every pixel, with interior samples counted as the maximum
+    float *data;
+    uint32_t width;
+    uint32_t height;
+    // maximum the samples were iterated up to, lower than requested for the coarser levels of a progressive view
+    uint32_t max_iterations;
+    // number of the buffer, increasing with every buffer handed from the compute thread to the main thread
+    uint32_t sequence;
+    // for every tile of {ITERATION_TILE_SIZE} pixels in row order, the sequence number of the last buffer in
+    // which a pixel of it changed, set by {generate}. NULL if changes are not tracked
+    uint32_t *tile_versions;
+} IterationBuffer;
+
+/**
+ * Called with an iteration buffer that is complete at a coarser level than the final one. Returns the buffer
+ * to continue in, which may be {t_buffer} or a copy of it. */
+typedef volatile IterationBuffer *(*publish_fun_t)(volatile IterationBuffer *t_buffer, void *t_arg);
+
+/** Number representation samples are iterated in. */
+typedef enum {
+    KERNEL_DOUBLE,
+    // for views too deep for doubles, at about twice the precision
+    KERNEL_DOUBLE_DOUBLE,
+    // for views too deep for double-doubles, as a difference to a reference orbit
+    KERNEL_PERTURBATION,
+} kernel_t;
+
+/** Rectangle of samples, with inclusive coordinates so that neighbouring rectangles can share a border. */
+typedef struct {
+    uint32_t x0, y0;
+    uint32_t x1, y1;
+} sample_rect_t;
+
+/**
+ * Iteration state of every sample of a view, kept between calls to {generate} so that raising the maximum
+ * number of iterations only continues the samples that have not escaped yet. */
+typedef struct IterationState {
+    // view, size, samples per pixel and mode the state belongs to
+    Fractal fractal;
+    uint32_t width;
+    uint32_t height;
+    uint32_t spp_x;
+    uint32_t spp_y;
+    bool subdivided;
+    // whether pixels are only evaluated entirely where they differ from a neighbour
+    bool adaptive;
+    // number of iterations done by all samples that have not escaped
+    uint32_t max_iterations;
+    // whether the last pass was cancelled, which leaves the samples in between two maximums
+    bool cancelled;
+    // number of samples that escaped during the last call to {generate}, a measure of how much raising the
+    // maximum still changes the view
+    uint32_t escaped;
+    // number of samples that escaped since the view was started over
+    uint32_t escaped_total;
+
+    // value of every sample, the fractional count if escaped, infinity if proven to be interior and
+    // {max_iterations} otherwise
+    float *samples;
+    uint32_t sample_count;
+    // whether a sample has been admitted to the active list, otherwise it is unknown or filled in
+    bool *evaluated;
+
+    // compacted list of samples that have not escaped, never containing an escaped sample
+    uint32_t active_count;
+    // samples from this index on were admitted after the last iterations and still start from zero
+    uint32_t new_start;
+    uint32_t *active_index; // index into {samples}
+    double *zr, *zi;        // current value of z, or its difference to the reference orbit
+    double *cr, *ci;        // value of c, or its difference to the reference point
+    double *zr_lo, *zi_lo;  // low parts of z for {KERNEL_DOUBLE_DOUBLE}, allocated on first use
+    double *cr_lo, *ci_lo;  // low parts of c for {KERNEL_DOUBLE_DOUBLE}, allocated on first use
+    uint32_t *ref_index;    // index into the reference orbit for {KERNEL_PERTURBATION}
+
+    // how samples are iterated, picked by the depth of the view
+    kernel_t kernel;
+    // reference orbit through the center of the view for {KERNEL_PERTURBATION}
+    ReferenceOrbit orbit;
+
+    // rectangles of which the inside is filled in from a uniform border, if {subdivided}
+    sample_rect_t *rects;
+    uint32_t rect_count;
+    uint32_t rect_capacity;
+} IterationState;
+
+/** Width of {p_fractal} on the real axis. */
+double fractal_re_size(Fractal p_fractal);
+
+/** Height of {p_fractal} on the imaginary axis. */
+double fractal_im_size(Fractal p_fractal);
+
+/** Whether {p_a} and {p_b} are the same view, unlike memcmp this does not depend on the padding of {Fractal}. */
+bool fractal_equal(Fractal p_a, Fractal p_b);
+
+/**
+ * Returns the view of {p_fractal} with its center moved by {re_offset} and {im_offset} and its size
+ * multiplied by {re_factor} and {im_factor}, all as fractions of the current size. The center is moved in
+ * high precision and the size is kept as a mantissa in [1, 2) with the exponent in {scale}. */
+Fractal zoom_fractal(Fractal p_fractal, double re_offset, double im_offset, double re_factor, double im_factor);
+
+/** Selects the fastest iteration kernel supported by the cpu, call once before {generate}. */
+void init_mandelbrot();
+
+/**
+ * Enables or disables the checks that find interior points without iterating them to the maximum: the test
+ * for the main cardioid and period-2 bulb before iterating, and periodicity detection while iterating.
+ * Both are enabled by default. Only applies to views that are iterated in doubles. */
+void set_interior_checks(bool p_cardioid, bool p_periodicity);
+
+/**
+ * Enables or disables Mariani-Silver subdivision: the frame is split into rectangles and only their borders
+ * are iterated, a rectangle with a uniform border is filled in and others are split further. Disabled by
+ * default, as filling in is not exact for the fractional count. Changing it starts the view over. */
+void set_subdivision(bool p_enabled);
+
+/**
+ * Enables or disables adaptive supersampling: only the first sample of every pixel is iterated, and the other
+ * samples of a pixel only if its first sample differs by more than {p_threshold} iterations from that of a
+ * neighbouring pixel, or if one of them is interior and the other is not. The samples of other pixels are
+ * filled in from the first one. Disabled by default, has no effect with subdivision or one sample per pixel.
+ * Changing it starts the view over. */
+void set_adaptive_supersampling(bool p_enabled, float p_threshold);
+
+/** Returns whether {c} lies in the main cardioid or the period-2 bulb, which are both interior. */
+bool in_cardioid_or_bulb(double cr, double ci);
 
 /**
  * Calculates iterations to converge, given a complex number.
  * Returns a value in [0, {max_iterations}]. */
 float mandelbrot(complex_t c, uint32_t max_iterations);
 
-void generate(
-        volatile Texture *p_texture, Fractal p_fractal, uint32_t p_max_iterations, uint32_t SPP_X, uint32_t SPP_Y
+/**
+ * Fractional iteration count of a point that escaped after {n} iterations, with {abs_sq} the squared
+ * magnitude of z at that moment. Returns {max_iterations} if {n} equals {max_iterations}. */
+float mandelbrot_smooth(uint32_t n, double abs_sq, uint32_t max_iterations);
+
+/**
+ * Continues iterating {count} samples, which all have done {n_start} iterations, up to {n_end} iterations.
+ * The value of z is read from and written back to {p_zr} and {p_zi}, c is read from {p_cr} and {p_ci}.
+ * Writes the fractional count of samples that escaped into {p_out}, and -1 for samples that did not.
+ * If {periodicity}, the value of z is compared against a value saved at every power of two iterations since
+ * {n_start} (Brent's cycle detection), a sample that returns to it is interior and gets infinity.
+ * Uses the kernel selected by {init_mandelbrot}. */
+void mandelbrot_span(
+        float *p_out, double *p_zr, double *p_zi, const double *p_cr, const double *p_ci, uint32_t count,
+        uint32_t n_start, uint32_t n_end, bool periodicity
+);
+
+/** Scalar fallback of {mandelbrot_span}. */
+void mandelbrot_span_scalar(
+        float *p_out, double *p_zr, double *p_zi, const double *p_cr, const double *p_ci, uint32_t count,
+        uint32_t n_start, uint32_t n_end, bool periodicity
+);
+
+/**
+ * Counterpart of {mandelbrot_span} for a view that is too deep for doubles, see {perturbation_span_scalar}.
+ * Returns the number of samples that were rebased to prevent glitches. */
+uint32_t perturbation_span(
+        float *p_out, double *p_dr, double *p_di, const double *p_dcr, const double *p_dci, uint32_t *p_ref_index,
+        uint32_t count, uint32_t n_start, uint32_t n_end, const ReferenceOrbit *p_orbit
+);
+
+/**
+ * Counterpart of {mandelbrot_span} for a view that is too deep for doubles, see {dd_span_scalar}.
+ * Uses the kernel selected by {init_mandelbrot}. */
+void dd_span(
+        float *p_out, double *p_zr, double *p_zr_lo, double *p_zi, double *p_zi_lo,
+        const double *p_cr, const double *p_cr_lo, const double *p_ci, const double *p_ci_lo,
+        uint32_t count, uint32_t n_start, uint32_t n_end
+);
+
+/**
+ * Writes the colors of {count} iteration values into {p_pixels} as packed RGBA, the color of value m is entry
+ * m * {PALETTE_STEPS} (rounded down) of {p_lut}. Uses the kernel selected by {init_mandelbrot}. */
+void colorize(uint32_t *p_pixels, const float *p_iterations, uint32_t count, const uint32_t *p_lut);
+
+/** Scalar fallback of {colorize}. */
+void colorize_scalar(uint32_t *p_pixels, const float *p_iterations, uint32_t count, const uint32_t *p_lut);
+
+/** Initializes an empty state, call to {delete_iteration_state} is required. */
+void create_iteration_state(IterationState *p_state);
+
+void delete_iteration_state(IterationState *p_state);
+
+/** Returns the number of bytes allocated by {p_state}. */
+size_t iteration_state_size(const IterationState *p_state);
+
+/**
+ * Returns whether raising the maximum number of iterations of {p_state} no longer changes its view: no sample
+ * is left to iterate, the maximum reached {MAX_ITER_LIMIT}, or fewer than {CONVERGED_FRACTION} of the samples
+ * escaped during the last pass while samples escaped before. Until the first samples escape, a deep view only
+ * needs a larger maximum. */
+bool iteration_state_converged(const IterationState *p_state);
+
+/** Returns the maximum number of iterations to continue a view at after a pass up to {p_max_iterations}. */
+uint32_t next_max_iterations(uint32_t p_max_iterations);
+
+/** Returns the number of tiles of {ITERATION_TILE_SIZE} pixels needed to cover {p_size} pixels. */
+uint32_t iteration_tile_count(uint32_t p_size);
+
+/**
+ * Computes the iteration buffer of {p_fractal}, of the size of {p_buffer}. If {p_state} holds the same view
+ * with fewer iterations, only its active samples are continued, otherwise it is reset and all samples start
+ * from zero. Once the spacing between samples drops below {DOUBLE_DOUBLE_SPACING}, samples are iterated in
+ * double-double, and below {DEEP_ZOOM_SPACING} by perturbation of a reference orbit through the center of the
+ * view. See {set_subdivision} for skipping uniform regions.
+ * Sets the version of the tiles of which a pixel changed to the sequence number of the buffer, if it has them.
+ * If {p_publish} is not NULL, a new view is computed progressively: every 16th and then every 4th sample is
+ * iterated first with a limited maximum (only the former with subdivision), after each of which the buffer
+ * is filled and passed to {p_publish} with {p_publish_arg}, and the levels after it go into the buffer it returns.
+ * A returned buffer of another size abandons the pass.
+ * Samples are iterated in chunks of the active list and pixels are averaged in tiles, both by the workers
+ * of {p_pool}.
+ * The workers check {p_cancel} every chunk and every few iterations, if it is set the pass is abandoned.
+ * Returns {EXIT_SUCCESS} if the buffer, the one last returned by {p_publish} if any, is complete, and
+ * {EXIT_FAILURE} if cancelled, if there are more than {UINT32_MAX} samples or if memory for them could not be
+ * allocated. */
+int generate(
+        volatile IterationBuffer *p_buffer, IterationState *p_state, Fractal p_fractal, uint32_t p_max_iterations,
+        uint32_t SPP_X, uint32_t SPP_Y, thread_pool_t *p_pool, publish_fun_t p_publish, void *p_publish_arg,
+        const atomic_bool *p_cancel
 );
 
 #endif //MANDELBROT_MANDELBROT_H
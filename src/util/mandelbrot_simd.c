@@ -0,0 +1,671 @@
+#include <stdint.h>
+#include "mandelbrot.h"
+#include "mandelbrot_simd.h"
+#include "perturbation.h"
+#include "dd.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+
+#include <immintrin.h>
+
+// kernels are compiled without fused multiply-add so they produce the same values as the scalar kernel
+
+bool mandelbrot_has_avx2()
+{
+    __builtin_cpu_init();
+    // the double-double kernel relies on fused multiply-add
+    return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+}
+
+bool mandelbrot_has_avx512()
+{
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx512f");
+}
+
+__attribute__((target("avx2,fma"), optimize("fp-contract=off")))
+void mandelbrot_span_avx2(
+        float *p_out, double *p_zr, double *p_zi, const double *p_cr, const double *p_ci, uint32_t count,
+        uint32_t n_start, uint32_t n_end, bool periodicity
+)
+{
+    const __m256d four = _mm256_set1_pd(4.0);
+    const __m256d one = _mm256_set1_pd(1.0);
+    const __m256d tolerance = _mm256_set1_pd(PERIODICITY_TOLERANCE);
+
+    uint32_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        __m256d cr = _mm256_loadu_pd(&p_cr[i]);
+        __m256d ci = _mm256_loadu_pd(&p_ci[i]);
+        __m256d zr = _mm256_loadu_pd(&p_zr[i]);
+        __m256d zi = _mm256_loadu_pd(&p_zi[i]);
+        __m256d n = _mm256_set1_pd(n_start);
+        __m256d escaped_abs_sq = _mm256_setzero_pd();
+        // all ones in lanes that have not escaped yet
+        __m256d active = _mm256_castsi256_pd(_mm256_set1_epi64x(-1));
+        // all ones in lanes that returned to an earlier value, all lanes share the schedule of saved values
+        __m256d interior = _mm256_setzero_pd();
+        __m256d check_r = zr, check_i = zi;
+        uint32_t check_at = 1;
+
+        for (uint32_t k = n_start; k < n_end; k++) {
+            __m256d zr2 = _mm256_mul_pd(zr, zr);
+            __m256d zi2 = _mm256_mul_pd(zi, zi);
+            __m256d abs_sq = _mm256_add_pd(zr2, zi2);
+
+            // record |z|^2 of lanes escaping in this iteration, needed for the fractional count
+            __m256d still = _mm256_and_pd(active, _mm256_cmp_pd(abs_sq, four, _CMP_LE_OQ));
+            escaped_abs_sq = _mm256_blendv_pd(escaped_abs_sq, abs_sq, _mm256_andnot_pd(still, active));
+            active = still;
+            if (_mm256_movemask_pd(active) == 0) break;
+
+            // escaped lanes keep iterating, but their count and recorded value are no longer updated
+            __m256d zrzi = _mm256_mul_pd(zr, zi);
+            zi = _mm256_add_pd(_mm256_add_pd(zrzi, zrzi), ci);
+            zr = _mm256_add_pd(_mm256_sub_pd(zr2, zi2), cr);
+            n = _mm256_add_pd(n, _mm256_and_pd(active, one));
+
+            if (periodicity) {
+                __m256d dr = _mm256_sub_pd(zr, check_r);
+                __m256d di = _mm256_sub_pd(zi, check_i);
+                __m256d d_sq = _mm256_add_pd(_mm256_mul_pd(dr, dr), _mm256_mul_pd(di, di));
+                __m256d cycle = _mm256_and_pd(active, _mm256_cmp_pd(d_sq, tolerance, _CMP_LT_OQ));
+                interior = _mm256_or_pd(interior, cycle);
+                active = _mm256_andnot_pd(cycle, active);
+                if (k + 1 - n_start == check_at) {
+                    check_r = zr;
+                    check_i = zi;
+                    check_at *= 2;
+                }
+            }
+        }
+
+        _mm256_storeu_pd(&p_zr[i], zr);
+        _mm256_storeu_pd(&p_zi[i], zi);
+
+        double n_lanes[4], abs_sq_lanes[4];
+        _mm256_storeu_pd(n_lanes, n);
+        _mm256_storeu_pd(abs_sq_lanes, escaped_abs_sq);
+        int active_lanes = _mm256_movemask_pd(active);
+        int interior_lanes = _mm256_movemask_pd(interior);
+        for (uint32_t l = 0; l < 4; l++) {
+            if (interior_lanes & (1 << l)) {
+                p_out[i + l] = INFINITY;
+            } else {
+                p_out[i + l] = (active_lanes & (1 << l)) ?
+                               -1.f : mandelbrot_smooth((uint32_t) n_lanes[l], abs_sq_lanes[l], n_end);
+            }
+        }
+    }
+
+    // remaining samples that do not fill a vector
+    mandelbrot_span_scalar(
+            &p_out[i], &p_zr[i], &p_zi[i], &p_cr[i], &p_ci[i], count - i, n_start, n_end, periodicity
+    );
+}
+
+__attribute__((target("avx512f"), optimize("fp-contract=off")))
+void mandelbrot_span_avx512(
+        float *p_out, double *p_zr, double *p_zi, const double *p_cr, const double *p_ci, uint32_t count,
+        uint32_t n_start, uint32_t n_end, bool periodicity
+)
+{
+    const __m512d four = _mm512_set1_pd(4.0);
+    const __m512d one = _mm512_set1_pd(1.0);
+    const __m512d tolerance = _mm512_set1_pd(PERIODICITY_TOLERANCE);
+
+    uint32_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        __m512d cr = _mm512_loadu_pd(&p_cr[i]);
+        __m512d ci = _mm512_loadu_pd(&p_ci[i]);
+        __m512d zr = _mm512_loadu_pd(&p_zr[i]);
+        __m512d zi = _mm512_loadu_pd(&p_zi[i]);
+        __m512d n = _mm512_set1_pd(n_start);
+        __m512d escaped_abs_sq = _mm512_setzero_pd();
+        // bit set for lanes that have not escaped yet
+        __mmask8 active = 0xff;
+        // bit set for lanes that returned to an earlier value, all lanes share the schedule of saved values
+        __mmask8 interior = 0;
+        __m512d check_r = zr, check_i = zi;
+        uint32_t check_at = 1;
+
+        for (uint32_t k = n_start; k < n_end; k++) {
+            __m512d zr2 = _mm512_mul_pd(zr, zr);
+            __m512d zi2 = _mm512_mul_pd(zi, zi);
+            __m512d abs_sq = _mm512_add_pd(zr2, zi2);
+
+            // record |z|^2 of lanes escaping in this iteration, needed for the fractional count
+            __mmask8 still = _mm512_mask_cmp_pd_mask(active, abs_sq, four, _CMP_LE_OQ);
+            escaped_abs_sq = _mm512_mask_mov_pd(escaped_abs_sq, active & ~still, abs_sq);
+            active = still;
+            if (active == 0) break;
+
+            __m512d zrzi = _mm512_mul_pd(zr, zi);
+            zi = _mm512_add_pd(_mm512_add_pd(zrzi, zrzi), ci);
+            zr = _mm512_add_pd(_mm512_sub_pd(zr2, zi2), cr);
+            n = _mm512_mask_add_pd(n, active, n, one);
+
+            if (periodicity) {
+                __m512d dr = _mm512_sub_pd(zr, check_r);
+                __m512d di = _mm512_sub_pd(zi, check_i);
+                __m512d d_sq = _mm512_add_pd(_mm512_mul_pd(dr, dr), _mm512_mul_pd(di, di));
+                __mmask8 cycle = _mm512_mask_cmp_pd_mask(active, d_sq, tolerance, _CMP_LT_OQ);
+                interior |= cycle;
+                active &= ~cycle;
+                if (k + 1 - n_start == check_at) {
+                    check_r = zr;
+                    check_i = zi;
+                    check_at *= 2;
+                }
+            }
+        }
+
+        _mm512_storeu_pd(&p_zr[i], zr);
+        _mm512_storeu_pd(&p_zi[i], zi);
+
+        double n_lanes[8], abs_sq_lanes[8];
+        _mm512_storeu_pd(n_lanes, n);
+        _mm512_storeu_pd(abs_sq_lanes, escaped_abs_sq);
+        for (uint32_t l = 0; l < 8; l++) {
+            if (interior & (1 << l)) {
+                p_out[i + l] = INFINITY;
+            } else {
+                p_out[i + l] = (active & (1 << l)) ?
+                               -1.f : mandelbrot_smooth((uint32_t) n_lanes[l], abs_sq_lanes[l], n_end);
+            }
+        }
+    }
+
+    // remaining samples that do not fill a vector
+    mandelbrot_span_scalar(
+            &p_out[i], &p_zr[i], &p_zi[i], &p_cr[i], &p_ci[i], count - i, n_start, n_end, periodicity
+    );
+}
+
+__attribute__((target("avx2,fma"), optimize("fp-contract=off")))
+uint32_t perturbation_span_avx2(
+        float *p_out, double *p_dr, double *p_di, const double *p_dcr, const double *p_dci, uint32_t *p_ref_index,
+        uint32_t count, uint32_t n_start, uint32_t n_end, const ReferenceOrbit *p_orbit
+)
+{
+    const __m256d four = _mm256_set1_pd(4.0);
+    const __m256d one = _mm256_set1_pd(1.0);
+    const __m256i one_index = _mm256_set1_epi64x(1);
+    const __m256i last = _mm256_set1_epi64x(p_orbit->length - 1);
+    uint32_t rebases = 0;
+
+    uint32_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        __m256d dcr = _mm256_loadu_pd(&p_dcr[i]);
+        __m256d dci = _mm256_loadu_pd(&p_dci[i]);
+        __m256d dr = _mm256_loadu_pd(&p_dr[i]);
+        __m256d di = _mm256_loadu_pd(&p_di[i]);
+        // index into the orbit per lane
+        __m256i m = _mm256_cvtepu32_epi64(_mm_loadu_si128((const __m128i *) &p_ref_index[i]));
+        __m256d n = _mm256_set1_pd(n_start);
+        __m256d escaped_abs_sq = _mm256_setzero_pd();
+        // all ones in lanes that have not escaped yet
+        __m256d active = _mm256_castsi256_pd(_mm256_set1_epi64x(-1));
+
+        for (uint32_t k = n_start; k < n_end; k++) {
+            __m256d orbit_r = _mm256_i64gather_pd(p_orbit->zr_orbit, m, 8);
+            __m256d orbit_i = _mm256_i64gather_pd(p_orbit->zi_orbit, m, 8);
+
+            // full value of z
+            __m256d zr = _mm256_add_pd(orbit_r, dr);
+            __m256d zi = _mm256_add_pd(orbit_i, di);
+            __m256d abs_sq = _mm256_add_pd(_mm256_mul_pd(zr, zr), _mm256_mul_pd(zi, zi));
+
+            __m256d still = _mm256_and_pd(active, _mm256_cmp_pd(abs_sq, four, _CMP_LE_OQ));
+            escaped_abs_sq = _mm256_blendv_pd(escaped_abs_sq, abs_sq, _mm256_andnot_pd(still, active));
+            active = still;
+            if (_mm256_movemask_pd(active) == 0) break;
+
+            // rebase lanes whose value is smaller than their difference, or that reached the end of the orbit
+            __m256d d_abs_sq = _mm256_add_pd(_mm256_mul_pd(dr, dr), _mm256_mul_pd(di, di));
+            __m256d rebase = _mm256_and_pd(active, _mm256_or_pd(
+                    _mm256_cmp_pd(abs_sq, d_abs_sq, _CMP_LT_OQ),
+                    _mm256_castsi256_pd(_mm256_cmpeq_epi64(m, last))
+            ));
+            int rebase_lanes = _mm256_movemask_pd(rebase);
+            if (rebase_lanes) {
+                dr = _mm256_blendv_pd(dr, zr, rebase);
+                di = _mm256_blendv_pd(di, zi, rebase);
+                orbit_r = _mm256_andnot_pd(rebase, orbit_r);
+                orbit_i = _mm256_andnot_pd(rebase, orbit_i);
+                m = _mm256_andnot_si256(_mm256_castpd_si256(rebase), m);
+                rebases += __builtin_popcount(rebase_lanes);
+            }
+
+            // d' = (2Z + d)d + dc
+            __m256d tr = _mm256_add_pd(_mm256_add_pd(orbit_r, orbit_r), dr);
+            __m256d ti = _mm256_add_pd(_mm256_add_pd(orbit_i, orbit_i), di);
+            __m256d dr_next = _mm256_add_pd(_mm256_sub_pd(_mm256_mul_pd(tr, dr), _mm256_mul_pd(ti, di)), dcr);
+            di = _mm256_add_pd(_mm256_add_pd(_mm256_mul_pd(tr, di), _mm256_mul_pd(ti, dr)), dci);
+            dr = dr_next;
+
+            // escaped lanes keep a valid index into the orbit
+            m = _mm256_add_epi64(m, _mm256_and_si256(_mm256_castpd_si256(active), one_index));
+            n = _mm256_add_pd(n, _mm256_and_pd(active, one));
+        }
+
+        _mm256_storeu_pd(&p_dr[i], dr);
+        _mm256_storeu_pd(&p_di[i], di);
+
+        uint64_t m_lanes[4];
+        double n_lanes[4], abs_sq_lanes[4];
+        _mm256_storeu_si256((__m256i *) m_lanes, m);
+        _mm256_storeu_pd(n_lanes, n);
+        _mm256_storeu_pd(abs_sq_lanes, escaped_abs_sq);
+        int active_lanes = _mm256_movemask_pd(active);
+        for (uint32_t l = 0; l < 4; l++) {
+            p_ref_index[i + l] = (uint32_t) m_lanes[l];
+            p_out[i + l] = (active_lanes & (1 << l)) ?
+                           -1.f : mandelbrot_smooth((uint32_t) n_lanes[l], abs_sq_lanes[l], n_end);
+        }
+    }
+
+    // remaining samples that do not fill a vector
+    return rebases + perturbation_span_scalar(
+            &p_out[i], &p_dr[i], &p_di[i], &p_dcr[i], &p_dci[i], &p_ref_index[i], count - i, n_start, n_end, p_orbit
+    );
+}
+
+__attribute__((target("avx512f"), optimize("fp-contract=off")))
+uint32_t perturbation_span_avx512(
+        float *p_out, double *p_dr, double *p_di, const double *p_dcr, const double *p_dci, uint32_t *p_ref_index,
+        uint32_t count, uint32_t n_start, uint32_t n_end, const ReferenceOrbit *p_orbit
+)
+{
+    const __m512d four = _mm512_set1_pd(4.0);
+    const __m512d one = _mm512_set1_pd(1.0);
+    const __m512i one_index = _mm512_set1_epi64(1);
+    const __m512i last = _mm512_set1_epi64(p_orbit->length - 1);
+    uint32_t rebases = 0;
+
+    uint32_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        __m512d dcr = _mm512_loadu_pd(&p_dcr[i]);
+        __m512d dci = _mm512_loadu_pd(&p_dci[i]);
+        __m512d dr = _mm512_loadu_pd(&p_dr[i]);
+        __m512d di = _mm512_loadu_pd(&p_di[i]);
+        // index into the orbit per lane
+        __m512i m = _mm512_cvtepu32_epi64(_mm256_loadu_si256((const __m256i *) &p_ref_index[i]));
+        __m512d n = _mm512_set1_pd(n_start);
+        __m512d escaped_abs_sq = _mm512_setzero_pd();
+        // bit set for lanes that have not escaped yet
+        __mmask8 active = 0xff;
+
+        for (uint32_t k = n_start; k < n_end; k++) {
+            __m512d orbit_r = _mm512_i64gather_pd(m, p_orbit->zr_orbit, 8);
+            __m512d orbit_i = _mm512_i64gather_pd(m, p_orbit->zi_orbit, 8);
+
+            // full value of z
+            __m512d zr = _mm512_add_pd(orbit_r, dr);
+            __m512d zi = _mm512_add_pd(orbit_i, di);
+            __m512d abs_sq = _mm512_add_pd(_mm512_mul_pd(zr, zr), _mm512_mul_pd(zi, zi));
+
+            __mmask8 still = _mm512_mask_cmp_pd_mask(active, abs_sq, four, _CMP_LE_OQ);
+            escaped_abs_sq = _mm512_mask_mov_pd(escaped_abs_sq, active & ~still, abs_sq);
+            active = still;
+            if (active == 0) break;
+
+            // rebase lanes whose value is smaller than their difference, or that reached the end of the orbit
+            __m512d d_abs_sq = _mm512_add_pd(_mm512_mul_pd(dr, dr), _mm512_mul_pd(di, di));
+            __mmask8 rebase = active & (_mm512_cmp_pd_mask(abs_sq, d_abs_sq, _CMP_LT_OQ) |
+                                        _mm512_cmpeq_epi64_mask(m, last));
+            if (rebase) {
+                dr = _mm512_mask_mov_pd(dr, rebase, zr);
+                di = _mm512_mask_mov_pd(di, rebase, zi);
+                orbit_r = _mm512_mask_mov_pd(orbit_r, rebase, _mm512_setzero_pd());
+                orbit_i = _mm512_mask_mov_pd(orbit_i, rebase, _mm512_setzero_pd());
+                m = _mm512_mask_mov_epi64(m, rebase, _mm512_setzero_si512());
+                rebases += __builtin_popcount(rebase);
+            }
+
+            // d' = (2Z + d)d + dc
+            __m512d tr = _mm512_add_pd(_mm512_add_pd(orbit_r, orbit_r), dr);
+            __m512d ti = _mm512_add_pd(_mm512_add_pd(orbit_i, orbit_i), di);
+            __m512d dr_next = _mm512_add_pd(_mm512_sub_pd(_mm512_mul_pd(tr, dr), _mm512_mul_pd(ti, di)), dcr);
+            di = _mm512_add_pd(_mm512_add_pd(_mm512_mul_pd(tr, di), _mm512_mul_pd(ti, dr)), dci);
+            dr = dr_next;
+
+            // escaped lanes keep a valid index into the orbit
+            m = _mm512_mask_add_epi64(m, active, m, one_index);
+            n = _mm512_mask_add_pd(n, active, n, one);
+        }
+
+        _mm512_storeu_pd(&p_dr[i], dr);
+        _mm512_storeu_pd(&p_di[i], di);
+        _mm256_storeu_si256((__m256i *) &p_ref_index[i], _mm512_cvtepi64_epi32(m));
+
+        double n_lanes[8], abs_sq_lanes[8];
+        _mm512_storeu_pd(n_lanes, n);
+        _mm512_storeu_pd(abs_sq_lanes, escaped_abs_sq);
+        for (uint32_t l = 0; l < 8; l++) {
+            p_out[i + l] = (active & (1 << l)) ?
+                           -1.f : mandelbrot_smooth((uint32_t) n_lanes[l], abs_sq_lanes[l], n_end);
+        }
+    }
+
+    // remaining samples that do not fill a vector
+    return rebases + perturbation_span_scalar(
+            &p_out[i], &p_dr[i], &p_di[i], &p_dcr[i], &p_dci[i], &p_ref_index[i], count - i, n_start, n_end, p_orbit
+    );
+}
+
+/** Double-double vector, the high and low parts of four lanes. */
+typedef struct {
+    __m256d hi;
+    __m256d lo;
+} dd4_t;
+
+__attribute__((target("avx2,fma"), always_inline))
+static inline dd4_t dd4_two_sum(__m256d a, __m256d b)
+{
+    __m256d s = _mm256_add_pd(a, b);
+    __m256d bb = _mm256_sub_pd(s, a);
+    dd4_t result = {s, _mm256_add_pd(_mm256_sub_pd(a, _mm256_sub_pd(s, bb)), _mm256_sub_pd(b, bb))};
+    return result;
+}
+
+__attribute__((target("avx2,fma"), always_inline))
+static inline dd4_t dd4_quick_two_sum(__m256d a, __m256d b)
+{
+    __m256d s = _mm256_add_pd(a, b);
+    dd4_t result = {s, _mm256_sub_pd(b, _mm256_sub_pd(s, a))};
+    return result;
+}
+
+__attribute__((target("avx2,fma"), always_inline))
+static inline dd4_t dd4_add(dd4_t x, dd4_t y)
+{
+    dd4_t s = dd4_two_sum(x.hi, y.hi);
+    dd4_t t = dd4_two_sum(x.lo, y.lo);
+    s = dd4_quick_two_sum(s.hi, _mm256_add_pd(s.lo, t.hi));
+    return dd4_quick_two_sum(s.hi, _mm256_add_pd(s.lo, t.lo));
+}
+
+__attribute__((target("avx2,fma"), always_inline))
+static inline dd4_t dd4_mul(dd4_t x, dd4_t y)
+{
+    // the rounding error of a product is exact with a fused multiply-subtract
+    __m256d p = _mm256_mul_pd(x.hi, y.hi);
+    __m256d e = _mm256_fmsub_pd(x.hi, y.hi, p);
+    e = _mm256_add_pd(e, _mm256_add_pd(_mm256_mul_pd(x.hi, y.lo), _mm256_mul_pd(x.lo, y.hi)));
+    return dd4_quick_two_sum(p, e);
+}
+
+__attribute__((target("avx2,fma"), always_inline))
+static inline dd4_t dd4_sqr(dd4_t x)
+{
+    __m256d p = _mm256_mul_pd(x.hi, x.hi);
+    __m256d e = _mm256_fmsub_pd(x.hi, x.hi, p);
+    e = _mm256_add_pd(e, _mm256_mul_pd(_mm256_add_pd(x.hi, x.hi), x.lo));
+    return dd4_quick_two_sum(p, e);
+}
+
+__attribute__((target("avx2,fma"), optimize("fp-contract=off")))
+void dd_span_avx2(
+        float *p_out, double *p_zr, double *p_zr_lo, double *p_zi, double *p_zi_lo,
+        const double *p_cr, const double *p_cr_lo, const double *p_ci, const double *p_ci_lo,
+        uint32_t count, uint32_t n_start, uint32_t n_end
+)
+{
+    const __m256d four = _mm256_set1_pd(4.0);
+    const __m256d one = _mm256_set1_pd(1.0);
+
+    uint32_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        dd4_t cr = {_mm256_loadu_pd(&p_cr[i]), _mm256_loadu_pd(&p_cr_lo[i])};
+        dd4_t ci = {_mm256_loadu_pd(&p_ci[i]), _mm256_loadu_pd(&p_ci_lo[i])};
+        dd4_t zr = {_mm256_loadu_pd(&p_zr[i]), _mm256_loadu_pd(&p_zr_lo[i])};
+        dd4_t zi = {_mm256_loadu_pd(&p_zi[i]), _mm256_loadu_pd(&p_zi_lo[i])};
+        __m256d n = _mm256_set1_pd(n_start);
+        __m256d escaped_abs_sq = _mm256_setzero_pd();
+        // all ones in lanes that have not escaped yet
+        __m256d active = _mm256_castsi256_pd(_mm256_set1_epi64x(-1));
+
+        for (uint32_t k = n_start; k < n_end; k++) {
+            // the bailout only needs the high parts
+            __m256d abs_sq = _mm256_add_pd(_mm256_mul_pd(zr.hi, zr.hi), _mm256_mul_pd(zi.hi, zi.hi));
+
+            __m256d still = _mm256_and_pd(active, _mm256_cmp_pd(abs_sq, four, _CMP_LE_OQ));
+            escaped_abs_sq = _mm256_blendv_pd(escaped_abs_sq, abs_sq, _mm256_andnot_pd(still, active));
+            active = still;
+            if (_mm256_movemask_pd(active) == 0) break;
+
+            dd4_t zrzi = dd4_mul(zr, zi);
+            dd4_t zi2 = dd4_sqr(zi);
+            dd4_t neg_zi2 = {_mm256_sub_pd(_mm256_setzero_pd(), zi2.hi), _mm256_sub_pd(_mm256_setzero_pd(), zi2.lo)};
+            zr = dd4_add(dd4_add(dd4_sqr(zr), neg_zi2), cr);
+            zi = dd4_add(dd4_add(zrzi, zrzi), ci);
+            n = _mm256_add_pd(n, _mm256_and_pd(active, one));
+        }
+
+        _mm256_storeu_pd(&p_zr[i], zr.hi);
+        _mm256_storeu_pd(&p_zr_lo[i], zr.lo);
+        _mm256_storeu_pd(&p_zi[i], zi.hi);
+        _mm256_storeu_pd(&p_zi_lo[i], zi.lo);
+
+        double n_lanes[4], abs_sq_lanes[4];
+        _mm256_storeu_pd(n_lanes, n);
+        _mm256_storeu_pd(abs_sq_lanes, escaped_abs_sq);
+        int active_lanes = _mm256_movemask_pd(active);
+        for (uint32_t l = 0; l < 4; l++) {
+            p_out[i + l] = (active_lanes & (1 << l)) ?
+                           -1.f : mandelbrot_smooth((uint32_t) n_lanes[l], abs_sq_lanes[l], n_end);
+        }
+    }
+
+    // remaining samples that do not fill a vector
+    dd_span_scalar(
+            &p_out[i], &p_zr[i], &p_zr_lo[i], &p_zi[i], &p_zi_lo[i], &p_cr[i], &p_cr_lo[i], &p_ci[i], &p_ci_lo[i],
+            count - i, n_start, n_end
+    );
+}
+
+/** Double-double vector, the high and low parts of eight lanes. */
+typedef struct {
+    __m512d hi;
+    __m512d lo;
+} dd8_t;
+
+__attribute__((target("avx512f"), always_inline))
+static inline dd8_t dd8_two_sum(__m512d a, __m512d b)
+{
+    __m512d s = _mm512_add_pd(a, b);
+    __m512d bb = _mm512_sub_pd(s, a);
+    dd8_t result = {s, _mm512_add_pd(_mm512_sub_pd(a, _mm512_sub_pd(s, bb)), _mm512_sub_pd(b, bb))};
+    return result;
+}
+
+__attribute__((target("avx512f"), always_inline))
+static inline dd8_t dd8_quick_two_sum(__m512d a, __m512d b)
+{
+    __m512d s = _mm512_add_pd(a, b);
+    dd8_t result = {s, _mm512_sub_pd(b, _mm512_sub_pd(s, a))};
+    return result;
+}
+
+__attribute__((target("avx512f"), always_inline))
+static inline dd8_t dd8_add(dd8_t x, dd8_t y)
+{
+    dd8_t s = dd8_two_sum(x.hi, y.hi);
+    dd8_t t = dd8_two_sum(x.lo, y.lo);
+    s = dd8_quick_two_sum(s.hi, _mm512_add_pd(s.lo, t.hi));
+    return dd8_quick_two_sum(s.hi, _mm512_add_pd(s.lo, t.lo));
+}
+
+__attribute__((target("avx512f"), always_inline))
+static inline dd8_t dd8_mul(dd8_t x, dd8_t y)
+{
+    // the rounding error of a product is exact with a fused multiply-subtract
+    __m512d p = _mm512_mul_pd(x.hi, y.hi);
+    __m512d e = _mm512_fmsub_pd(x.hi, y.hi, p);
+    e = _mm512_add_pd(e, _mm512_add_pd(_mm512_mul_pd(x.hi, y.lo), _mm512_mul_pd(x.lo, y.hi)));
+    return dd8_quick_two_sum(p, e);
+}
+
+__attribute__((target("avx512f"), always_inline))
+static inline dd8_t dd8_sqr(dd8_t x)
+{
+    __m512d p = _mm512_mul_pd(x.hi, x.hi);
+    __m512d e = _mm512_fmsub_pd(x.hi, x.hi, p);
+    e = _mm512_add_pd(e, _mm512_mul_pd(_mm512_add_pd(x.hi, x.hi), x.lo));
+    return dd8_quick_two_sum(p, e);
+}
+
+__attribute__((target("avx512f"), optimize("fp-contract=off")))
+void dd_span_avx512(
+        float *p_out, double *p_zr, double *p_zr_lo, double *p_zi, double *p_zi_lo,
+        const double *p_cr, const double *p_cr_lo, const double *p_ci, const double *p_ci_lo,
+        uint32_t count, uint32_t n_start, uint32_t n_end
+)
+{
+    const __m512d four = _mm512_set1_pd(4.0);
+    const __m512d one = _mm512_set1_pd(1.0);
+
+    uint32_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        dd8_t cr = {_mm512_loadu_pd(&p_cr[i]), _mm512_loadu_pd(&p_cr_lo[i])};
+        dd8_t ci = {_mm512_loadu_pd(&p_ci[i]), _mm512_loadu_pd(&p_ci_lo[i])};
+        dd8_t zr = {_mm512_loadu_pd(&p_zr[i]), _mm512_loadu_pd(&p_zr_lo[i])};
+        dd8_t zi = {_mm512_loadu_pd(&p_zi[i]), _mm512_loadu_pd(&p_zi_lo[i])};
+        __m512d n = _mm512_set1_pd(n_start);
+        __m512d escaped_abs_sq = _mm512_setzero_pd();
+        // bit set for lanes that have not escaped yet
+        __mmask8 active = 0xff;
+
+        for (uint32_t k = n_start; k < n_end; k++) {
+            // the bailout only needs the high parts
+            __m512d abs_sq = _mm512_add_pd(_mm512_mul_pd(zr.hi, zr.hi), _mm512_mul_pd(zi.hi, zi.hi));
+
+            __mmask8 still = _mm512_mask_cmp_pd_mask(active, abs_sq, four, _CMP_LE_OQ);
+            escaped_abs_sq = _mm512_mask_mov_pd(escaped_abs_sq, active & ~still, abs_sq);
+            active = still;
+            if (active == 0) break;
+
+            dd8_t zrzi = dd8_mul(zr, zi);
+            dd8_t zi2 = dd8_sqr(zi);
+            dd8_t neg_zi2 = {_mm512_sub_pd(_mm512_setzero_pd(), zi2.hi), _mm512_sub_pd(_mm512_setzero_pd(), zi2.lo)};
+            zr = dd8_add(dd8_add(dd8_sqr(zr), neg_zi2), cr);
+            zi = dd8_add(dd8_add(zrzi, zrzi), ci);
+            n = _mm512_mask_add_pd(n, active, n, one);
+        }
+
+        _mm512_storeu_pd(&p_zr[i], zr.hi);
+        _mm512_storeu_pd(&p_zr_lo[i], zr.lo);
+        _mm512_storeu_pd(&p_zi[i], zi.hi);
+        _mm512_storeu_pd(&p_zi_lo[i], zi.lo);
+
+        double n_lanes[8], abs_sq_lanes[8];
+        _mm512_storeu_pd(n_lanes, n);
+        _mm512_storeu_pd(abs_sq_lanes, escaped_abs_sq);
+        for (uint32_t l = 0; l < 8; l++) {
+            p_out[i + l] = (active & (1 << l)) ?
+                           -1.f : mandelbrot_smooth((uint32_t) n_lanes[l], abs_sq_lanes[l], n_end);
+        }
+    }
+
+    // remaining samples that do not fill a vector
+    dd_span_scalar(
+            &p_out[i], &p_zr[i], &p_zr_lo[i], &p_zi[i], &p_zi_lo[i], &p_cr[i], &p_cr_lo[i], &p_ci[i], &p_ci_lo[i],
+            count - i, n_start, n_end
+    );
+}
+
+__attribute__((target("avx2,fma")))
+void colorize_avx2(uint32_t *p_pixels, const float *p_iterations, uint32_t count, const uint32_t *p_lut)
+{
+    const __m256 steps = _mm256_set1_ps((float) PALETTE_STEPS);
+
+    uint32_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        // the product is exact, so truncating rounds down like the scalar kernel
+        __m256i index = _mm256_cvttps_epi32(_mm256_mul_ps(_mm256_loadu_ps(&p_iterations[i]), steps));
+        __m256i rgba = _mm256_i32gather_epi32((const int *) p_lut, index, sizeof(uint32_t));
+        _mm256_storeu_si256((__m256i *) &p_pixels[i], rgba);
+    }
+
+    // remaining pixels that do not fill a vector
+    colorize_scalar(&p_pixels[i], &p_iterations[i], count - i, p_lut);
+}
+
+__attribute__((target("avx512f")))
+void colorize_avx512(uint32_t *p_pixels, const float *p_iterations, uint32_t count, const uint32_t *p_lut)
+{
+    const __m512 steps = _mm512_set1_ps((float) PALETTE_STEPS);
+
+    uint32_t i = 0;
+    for (; i + 16 <= count; i += 16) {
+        __m512i index = _mm512_cvttps_epi32(_mm512_mul_ps(_mm512_loadu_ps(&p_iterations[i]), steps));
+        __m512i rgba = _mm512_i32gather_epi32(index, (const int *) p_lut, sizeof(uint32_t));
+        _mm512_storeu_si512(&p_pixels[i], rgba);
+    }
+
+    // remaining pixels that do not fill a vector
+    colorize_scalar(&p_pixels[i], &p_iterations[i], count - i, p_lut);
+}
+
+#else // not x86, only the scalar kernel is available
+
+bool mandelbrot_has_avx2()
+{
+    return false;
+}
+
+bool mandelbrot_has_avx512()
+{
+    return false;
+}
+
+void mandelbrot_span_avx2(
+        float *p_out, double *p_zr, double *p_zi, const double *p_cr, const double *p_ci, uint32_t count,
+        uint32_t n_start, uint32_t n_end, bool periodicity
+)
+{}
+
+void mandelbrot_span_avx512(
+        float *p_out, double *p_zr, double *p_zi, const double *p_cr, const double *p_ci, uint32_t count,
+        uint32_t n_start, uint32_t n_end, bool periodicity
+)
+{}
+
+uint32_t perturbation_span_avx2(
+        float *p_out, double *p_dr, double *p_di, const double *p_dcr, const double *p_dci, uint32_t *p_ref_index,
+        uint32_t count, uint32_t n_start, uint32_t n_end, const ReferenceOrbit *p_orbit
+)
+{
+    return 0;
+}
+
+uint32_t perturbation_span_avx512(
+        float *p_out, double *p_dr, double *p_di, const double *p_dcr, const double *p_dci, uint32_t *p_ref_index,
+        uint32_t count, uint32_t n_start, uint32_t n_end, const ReferenceOrbit *p_orbit
+)
+{
+    return 0;
+}
+
+void dd_span_avx2(
+        float *p_out, double *p_zr, double *p_zr_lo, double *p_zi, double *p_zi_lo,
+        const double *p_cr, const double *p_cr_lo, const double *p_ci, const double *p_ci_lo,
+        uint32_t count, uint32_t n_start, uint32_t n_end
+)
+{}
+
+void dd_span_avx512(
+        float *p_out, double *p_zr, double *p_zr_lo, double *p_zi, double *p_zi_lo,
+        const double *p_cr, const double *p_cr_lo, const double *p_ci, const double *p_ci_lo,
+        uint32_t count, uint32_t n_start, uint32_t n_end
+)
+{}
+
+void colorize_avx2(uint32_t *p_pixels, const float *p_iterations, uint32_t count, const uint32_t *p_lut)
+{}
+
+void colorize_avx512(uint32_t *p_pixels, const float *p_iterations, uint32_t count, const uint32_t *p_lut)
+{}
+
+#endif
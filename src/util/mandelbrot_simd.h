@@ -0,0 +1,75 @@
+#ifndef MANDELBROT_MANDELBROT_SIMD_H
+#define MANDELBROT_MANDELBROT_SIMD_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "perturbation.h"
+#include "dd.h"
+
+/** Returns whether the cpu supports the AVX2 kernels, which also require FMA. */
+bool mandelbrot_has_avx2();
+
+/** Returns whether the cpu supports the AVX-512 kernel. */
+bool mandelbrot_has_avx512();
+
+/**
+ * Iterates four samples per vector, only call if {mandelbrot_has_avx2} returns true.
+ * Arguments are identical to those of {mandelbrot_span}. */
+void mandelbrot_span_avx2(
+        float *p_out, double *p_zr, double *p_zi, const double *p_cr, const double *p_ci, uint32_t count,
+        uint32_t n_start, uint32_t n_end, bool periodicity
+);
+
+/**
+ * Iterates eight samples per vector, only call if {mandelbrot_has_avx512} returns true.
+ * Arguments are identical to those of {mandelbrot_span}. */
+void mandelbrot_span_avx512(
+        float *p_out, double *p_zr, double *p_zi, const double *p_cr, const double *p_ci, uint32_t count,
+        uint32_t n_start, uint32_t n_end, bool periodicity
+);
+
+/**
+ * Perturbation kernel with four samples per vector, only call if {mandelbrot_has_avx2} returns true.
+ * Arguments are identical to those of {perturbation_span}. */
+uint32_t perturbation_span_avx2(
+        float *p_out, double *p_dr, double *p_di, const double *p_dcr, const double *p_dci, uint32_t *p_ref_index,
+        uint32_t count, uint32_t n_start, uint32_t n_end, const ReferenceOrbit *p_orbit
+);
+
+/**
+ * Perturbation kernel with eight samples per vector, only call if {mandelbrot_has_avx512} returns true.
+ * Arguments are identical to those of {perturbation_span}. */
+uint32_t perturbation_span_avx512(
+        float *p_out, double *p_dr, double *p_di, const double *p_dcr, const double *p_dci, uint32_t *p_ref_index,
+        uint32_t count, uint32_t n_start, uint32_t n_end, const ReferenceOrbit *p_orbit
+);
+
+/**
+ * Double-double kernel with four samples per vector, only call if {mandelbrot_has_avx2} returns true.
+ * Arguments are identical to those of {dd_span}. */
+void dd_span_avx2(
+        float *p_out, double *p_zr, double *p_zr_lo, double *p_zi, double *p_zi_lo,
+        const double *p_cr, const double *p_cr_lo, const double *p_ci, const double *p_ci_lo,
+        uint32_t count, uint32_t n_start, uint32_t n_end
+);
+
+/**
+ * Double-double kernel with eight samples per vector, only call if {mandelbrot_has_avx512} returns true.
+ * Arguments are identical to those of {dd_span}. */
+void dd_span_avx512(
+        float *p_out, double *p_zr, double *p_zr_lo, double *p_zi, double *p_zi_lo,
+        const double *p_cr, const double *p_cr_lo, const double *p_ci, const double *p_ci_lo,
+        uint32_t count, uint32_t n_start, uint32_t n_end
+);
+
+/**
+ * Looks up eight colors per vector, only call if {mandelbrot_has_avx2} returns true.
+ * Arguments are identical to those of {colorize}. */
+void colorize_avx2(uint32_t *p_pixels, const float *p_iterations, uint32_t count, const uint32_t *p_lut);
+
+/**
+ * Looks up sixteen colors per vector, only call if {mandelbrot_has_avx512} returns true.
+ * Arguments are identical to those of {colorize}. */
+void colorize_avx512(uint32_t *p_pixels, const float *p_iterations, uint32_t count, const uint32_t *p_lut);
+
+#endif //MANDELBROT_MANDELBROT_SIMD_H
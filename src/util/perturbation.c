@@ -0,0 +1,124 @@
+#include <stdlib.h>
+#include "perturbation.h"
+#include "mandelbrot.h"
+#include "log.h"
+
+int create_reference_orbit(ReferenceOrbit *p_orbit, hp_t cr, hp_t ci)
+{
+    p_orbit->cr = cr;
+    p_orbit->ci = ci;
+    p_orbit->zr = hp_from_double(0);
+    p_orbit->zi = hp_from_double(0);
+
+    p_orbit->capacity = 1024;
+    p_orbit->zr_orbit = malloc(sizeof(double) * p_orbit->capacity);
+    p_orbit->zi_orbit = malloc(sizeof(double) * p_orbit->capacity);
+    if (p_orbit->zr_orbit == NULL || p_orbit->zi_orbit == NULL) {
+        nm_log(LOG_ERROR, "could not allocate memory for reference orbit\n");
+        free(p_orbit->zi_orbit);
+        free(p_orbit->zr_orbit);
+
+        return EXIT_FAILURE;
+    }
+
+    // Z_0 = 0
+    p_orbit->zr_orbit[0] = 0.;
+    p_orbit->zi_orbit[0] = 0.;
+    p_orbit->length = 1;
+    p_orbit->escaped = false;
+
+    return EXIT_SUCCESS;
+}
+
+void delete_reference_orbit(ReferenceOrbit *p_orbit)
+{
+    free(p_orbit->zi_orbit);
+    free(p_orbit->zr_orbit);
+}
+
+int extend_reference_orbit(ReferenceOrbit *p_orbit, uint32_t max_iterations)
+{
+    // a sample at iteration n reads Z_n, and at most max_iterations - 1 is reached
+    while (!p_orbit->escaped && p_orbit->length <= max_iterations) {
+        if (p_orbit->length == p_orbit->capacity) {
+            double *zr_orbit = realloc(p_orbit->zr_orbit, sizeof(double) * p_orbit->capacity * 2);
+            if (zr_orbit != NULL) p_orbit->zr_orbit = zr_orbit;
+            double *zi_orbit = realloc(p_orbit->zi_orbit, sizeof(double) * p_orbit->capacity * 2);
+            if (zi_orbit != NULL) p_orbit->zi_orbit = zi_orbit;
+            if (zr_orbit == NULL || zi_orbit == NULL) {
+                nm_log(LOG_ERROR, "could not grow reference orbit beyond %u iterations\n", p_orbit->length);
+
+                return EXIT_FAILURE;
+            }
+            p_orbit->capacity *= 2;
+        }
+
+        hp_t zr2 = hp_mul(p_orbit->zr, p_orbit->zr);
+        hp_t zi2 = hp_mul(p_orbit->zi, p_orbit->zi);
+        hp_t zrzi = hp_mul(p_orbit->zr, p_orbit->zi);
+        p_orbit->zi = hp_add(hp_add(zrzi, zrzi), p_orbit->ci);
+        p_orbit->zr = hp_add(hp_sub(zr2, zi2), p_orbit->cr);
+
+        double zr = hp_to_double(p_orbit->zr);
+        double zi = hp_to_double(p_orbit->zi);
+        p_orbit->zr_orbit[p_orbit->length] = zr;
+        p_orbit->zi_orbit[p_orbit->length] = zi;
+        p_orbit->length++;
+
+        // an escaped value is kept, samples still read it before they are rebased
+        if (zr * zr + zi * zi > 4) {
+            p_orbit->escaped = true;
+        }
+    }
+
+    return EXIT_SUCCESS;
+}
+
+uint32_t perturbation_span_scalar(
+        float *p_out, double *p_dr, double *p_di, const double *p_dcr, const double *p_dci, uint32_t *p_ref_index,
+        uint32_t count, uint32_t n_start, uint32_t n_end, const ReferenceOrbit *p_orbit
+)
+{
+    const double *orbit_r = p_orbit->zr_orbit;
+    const double *orbit_i = p_orbit->zi_orbit;
+    uint32_t last = p_orbit->length - 1;
+    uint32_t rebases = 0;
+
+    for (uint32_t i = 0; i < count; i++) {
+        double dr = p_dr[i], di = p_di[i];
+        uint32_t m = p_ref_index[i];
+        uint32_t n = n_start;
+        double abs_sq = 0;
+
+        while (n < n_end) {
+            // full value of z
+            double zr = orbit_r[m] + dr;
+            double zi = orbit_i[m] + di;
+            abs_sq = zr * zr + zi * zi;
+            if (abs_sq > 4) break;
+
+            if (abs_sq < dr * dr + di * di || m == last) {
+                dr = zr;
+                di = zi;
+                m = 0;
+                rebases++;
+            }
+
+            // d' = (2Z + d)d + dc
+            double tr = 2 * orbit_r[m] + dr;
+            double ti = 2 * orbit_i[m] + di;
+            double dr_next = tr * dr - ti * di + p_dcr[i];
+            di = tr * di + ti * dr + p_dci[i];
+            dr = dr_next;
+            m++;
+            n++;
+        }
+
+        p_dr[i] = dr;
+        p_di[i] = di;
+        p_ref_index[i] = m;
+        p_out[i] = n == n_end ? -1.f : mandelbrot_smooth(n, abs_sq, n_end);
+    }
+
+    return rebases;
+}
@@ -0,0 +1,54 @@
+#ifndef MANDELBROT_PERTURBATION_H
+#define MANDELBROT_PERTURBATION_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "hp.h"
+
+/**
+ * Orbit of a single reference point, iterated in high precision and stored in doubles. Every other sample
+ * is iterated as a small difference to this orbit, which does not need more precision than a double. */
+typedef struct ReferenceOrbit {
+    // the reference point
+    hp_t cr;
+    hp_t ci;
+    // last value of z in high precision, to extend the orbit from
+    hp_t zr;
+    hp_t zi;
+
+    // values Z_0 to Z_{length - 1}
+    double *zr_orbit;
+    double *zi_orbit;
+    uint32_t length;
+    uint32_t capacity;
+
+    // whether the last value escaped, in which case the orbit is not extended any further
+    bool escaped;
+} ReferenceOrbit;
+
+/**
+ * Starts an orbit at reference point {cr} + {ci}i, call to {delete_reference_orbit} is required if
+ * {EXIT_SUCCESS} is returned. */
+int create_reference_orbit(ReferenceOrbit *p_orbit, hp_t cr, hp_t ci);
+
+void delete_reference_orbit(ReferenceOrbit *p_orbit);
+
+/**
+ * Extends the orbit far enough to iterate samples up to {max_iterations}, or until it escapes. Returns
+ * {EXIT_FAILURE} if the orbit could not grow, in which case it keeps the values it has and samples that reach
+ * its end are rebased onto its start, which is less accurate but still safe. */
+int extend_reference_orbit(ReferenceOrbit *p_orbit, uint32_t max_iterations);
+
+/**
+ * Counterpart of {mandelbrot_span} for samples given as a difference to a reference orbit.
+ * {p_dr} and {p_di} hold the difference of z, {p_dcr} and {p_dci} the difference of c and {p_ref_index}
+ * the index into the orbit every sample follows, all read and written back.
+ * A sample whose value gets closer to zero than its difference, or that reaches the end of the orbit, is a
+ * glitch waiting to happen: it is rebased onto the start of the orbit, with its full value as difference.
+ * Returns the number of rebases. */
+uint32_t perturbation_span_scalar(
+        float *p_out, double *p_dr, double *p_di, const double *p_dcr, const double *p_dci, uint32_t *p_ref_index,
+        uint32_t count, uint32_t n_start, uint32_t n_end, const ReferenceOrbit *p_orbit
+);
+
+#endif //MANDELBROT_PERTURBATION_H
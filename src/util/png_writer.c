@@ -0,0 +1,288 @@
+#include <stdlib.h>
+#include <string.h>
+#include "png_writer.h"
+
+// compressed bytes per IDAT chunk
+#define PNG_CHUNK_SIZE (1u << 20)
+// number of filter types of a png, a row is written with the one that suits it best
+#define PNG_FILTER_COUNT 5
+// a match of deflate is between 3 and 258 bytes long
+#define MIN_MATCH 3
+#define MAX_MATCH 258
+// the sums of Adler-32 can be taken modulo after this many bytes without overflowing
+#define ADLER_BLOCK 5552
+
+// first length of every length symbol from 257 on, and the number of extra bits that follow it
+static const uint16_t LENGTH_BASE[] = {
+        3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31, 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195,
+        227, 258
+};
+static const uint8_t LENGTH_EXTRA[] = {
+        0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0
+};
+
+static void store_u32(uint8_t *t_bytes, uint32_t t_value)
+{
+    t_bytes[0] = (uint8_t) (t_value >> 24);
+    t_bytes[1] = (uint8_t) (t_value >> 16);
+    t_bytes[2] = (uint8_t) (t_value >> 8);
+    t_bytes[3] = (uint8_t) t_value;
+}
+
+/** Writes a chunk of {t_type} with {t_size} bytes of {t_data}, followed by its CRC-32. */
+static void write_chunk(png_writer_t *t_writer, const char *t_type, const uint8_t *t_data, uint32_t t_size)
+{
+    if (t_writer->m_failed) return;
+
+    uint32_t table[256];
+    for (uint32_t i = 0; i < 256; i++) {
+        uint32_t c = i;
+        for (uint32_t k = 0; k < 8; k++) {
+            c = c & 1 ? 0xedb88320u ^ (c >> 1) : c >> 1;
+        }
+        table[i] = c;
+    }
+
+    // the checksum covers the type and the data
+    uint32_t crc = 0xffffffffu;
+    for (uint32_t i = 0; i < 4; i++) {
+        crc = table[(crc ^ (uint8_t) t_type[i]) & 0xff] ^ (crc >> 8);
+    }
+    for (uint32_t i = 0; i < t_size; i++) {
+        crc = table[(crc ^ t_data[i]) & 0xff] ^ (crc >> 8);
+    }
+
+    uint8_t size[4], checksum[4];
+    store_u32(size, t_size);
+    store_u32(checksum, crc ^ 0xffffffffu);
+    if (fwrite(size, 1, 4, t_writer->m_file) != 4 || fwrite(t_type, 1, 4, t_writer->m_file) != 4 ||
+        fwrite(t_data, 1, t_size, t_writer->m_file) != t_size || fwrite(checksum, 1, 4, t_writer->m_file) != 4) {
+        t_writer->m_failed = true;
+    }
+}
+
+/** Appends a compressed byte, writing the chunk once it is full. */
+static void put_byte(png_writer_t *t_writer, uint8_t t_byte)
+{
+    t_writer->m_chunk[t_writer->m_chunk_size++] = t_byte;
+    if (t_writer->m_chunk_size == PNG_CHUNK_SIZE) {
+        write_chunk(t_writer, "IDAT", t_writer->m_chunk, t_writer->m_chunk_size);
+        t_writer->m_chunk_size = 0;
+    }
+}
+
+/** Appends the {t_count} lowest bits of {t_value}, least significant first. */
+static void put_bits(png_writer_t *t_writer, uint32_t t_value, uint32_t t_count)
+{
+    t_writer->m_bits |= (uint64_t) t_value << t_writer->m_bit_count;
+    t_writer->m_bit_count += t_count;
+    while (t_writer->m_bit_count >= 8) {
+        put_byte(t_writer, (uint8_t) t_writer->m_bits);
+        t_writer->m_bits >>= 8;
+        t_writer->m_bit_count -= 8;
+    }
+}
+
+/** Appends Huffman code {t_code} of {t_length} bits, which are stored most significant first. */
+static void put_code(png_writer_t *t_writer, uint32_t t_code, uint32_t t_length)
+{
+    uint32_t reversed = 0;
+    for (uint32_t i = 0; i < t_length; i++) {
+        reversed = (reversed << 1) | ((t_code >> i) & 1);
+    }
+    put_bits(t_writer, reversed, t_length);
+}
+
+/** Appends literal/length symbol {t_symbol} in the fixed Huffman code. */
+static void put_symbol(png_writer_t *t_writer, uint32_t t_symbol)
+{
+    if (t_symbol < 144) {
+        put_code(t_writer, 0x30 + t_symbol, 8);
+    } else if (t_symbol < 256) {
+        put_code(t_writer, 0x190 + t_symbol - 144, 9);
+    } else if (t_symbol < 280) {
+        put_code(t_writer, t_symbol - 256, 7);
+    } else {
+        put_code(t_writer, 0xc0 + t_symbol - 280, 8);
+    }
+}
+
+/** Appends a match of {t_length} bytes at a distance of one, which repeats the last byte. */
+static void put_run(png_writer_t *t_writer, uint32_t t_length)
+{
+    uint32_t code = 28;
+    while (LENGTH_BASE[code] > t_length) code--;
+    put_symbol(t_writer, 257 + code);
+    put_bits(t_writer, t_length - LENGTH_BASE[code], LENGTH_EXTRA[code]);
+    // distance symbol 0, a distance of one, has a five bit code of zeros
+    put_code(t_writer, 0, 5);
+}
+
+/** Compresses {t_size} bytes of the uncompressed stream. */
+static void put_data(png_writer_t *t_writer, const uint8_t *t_data, uint32_t t_size)
+{
+    /** checksum */
+    for (uint32_t start = 0; start < t_size; start += ADLER_BLOCK) {
+        uint32_t end = start + ADLER_BLOCK < t_size ? start + ADLER_BLOCK : t_size;
+        for (uint32_t i = start; i < end; i++) {
+            t_writer->m_adler_a += t_data[i];
+            t_writer->m_adler_b += t_writer->m_adler_a;
+        }
+        t_writer->m_adler_a %= 65521;
+        t_writer->m_adler_b %= 65521;
+    }
+
+    /** runs of the last byte are matches, other bytes literals */
+    uint32_t i = 0;
+    while (i < t_size) {
+        uint32_t run = 0;
+        while (i + run < t_size && run < MAX_MATCH && t_data[i + run] == t_writer->m_last_byte) run++;
+
+        if (run >= MIN_MATCH) {
+            put_run(t_writer, run);
+            i += run;
+        } else {
+            put_symbol(t_writer, t_data[i]);
+            t_writer->m_last_byte = t_data[i];
+            i++;
+        }
+    }
+}
+
+/** Predictor of the Paeth filter, from the bytes to the left, above and above left. */
+static uint8_t paeth(uint8_t a, uint8_t b, uint8_t c)
+{
+    int32_t p = (int32_t) a + b - c;
+    int32_t pa = abs(p - a), pb = abs(p - b), pc = abs(p - c);
+    if (pa <= pb && pa <= pc) return a;
+    if (pb <= pc) return b;
+
+    return c;
+}
+
+int create_png_writer(
+        png_writer_t *t_writer, const char *t_path, uint32_t t_width, uint32_t t_height, uint32_t t_channels
+)
+{
+    memset(t_writer, 0, sizeof(png_writer_t));
+    if (t_channels != 3 && t_channels != 4) return EXIT_FAILURE;
+
+    // allocated before the file is created, so that no file is left behind if they cannot be
+    size_t row_size = (size_t) t_width * t_channels;
+    t_writer->m_previous_row = calloc(row_size, 1);
+    t_writer->m_filtered_rows = malloc((row_size + 1) * PNG_FILTER_COUNT);
+    t_writer->m_chunk = malloc(PNG_CHUNK_SIZE);
+    if (t_writer->m_previous_row != NULL && t_writer->m_filtered_rows != NULL && t_writer->m_chunk != NULL) {
+        t_writer->m_file = fopen(t_path, "wb");
+    }
+    if (t_writer->m_file == NULL) {
+        free(t_writer->m_chunk);
+        free(t_writer->m_filtered_rows);
+        free(t_writer->m_previous_row);
+
+        return EXIT_FAILURE;
+    }
+
+    t_writer->m_width = t_width;
+    t_writer->m_height = t_height;
+    t_writer->m_channels = t_channels;
+    t_writer->m_last_byte = -1;
+    t_writer->m_adler_a = 1;
+    t_writer->m_adler_b = 0;
+
+    /** signature and header, 8 bits per channel of truecolor with or without alpha */
+    static const uint8_t signature[] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n'};
+    if (fwrite(signature, 1, sizeof(signature), t_writer->m_file) != sizeof(signature)) {
+        t_writer->m_failed = true;
+    }
+    uint8_t header[13];
+    store_u32(&header[0], t_width);
+    store_u32(&header[4], t_height);
+    header[8] = 8;
+    header[9] = t_channels == 4 ? 6 : 2;
+    header[10] = 0; // deflate
+    header[11] = 0; // adaptive filtering
+    header[12] = 0; // no interlacing
+    write_chunk(t_writer, "IHDR", header, sizeof(header));
+
+    /** zlib header for deflate with a window of 32 KiB, and the start of a block of fixed Huffman codes */
+    put_byte(t_writer, 0x78);
+    put_byte(t_writer, 0x01);
+    put_bits(t_writer, 0, 1); // not the final block
+    put_bits(t_writer, 1, 2); // fixed Huffman codes
+
+    return EXIT_SUCCESS;
+}
+
+int png_writer_write_rows(png_writer_t *t_writer, const uint8_t *t_pixels, uint32_t t_count)
+{
+    uint32_t bpp = t_writer->m_channels;
+    uint32_t row_size = t_writer->m_width * bpp;
+    for (uint32_t r = 0; r < t_count && t_writer->m_rows_written < t_writer->m_height; r++) {
+        const uint8_t *row = &t_pixels[(size_t) r * row_size];
+        const uint8_t *up = t_writer->m_previous_row;
+
+        /** apply every filter, and keep the one with the smallest sum of absolute differences */
+        uint32_t best = 0;
+        uint64_t best_sum = UINT64_MAX;
+        for (uint32_t f = 0; f < PNG_FILTER_COUNT; f++) {
+            uint8_t *out = &t_writer->m_filtered_rows[(size_t) f * (row_size + 1)];
+            out[0] = (uint8_t) f;
+            uint64_t sum = 0;
+            for (uint32_t i = 0; i < row_size; i++) {
+                uint8_t left = i >= bpp ? row[i - bpp] : 0;
+                uint8_t up_left = i >= bpp ? up[i - bpp] : 0;
+                uint8_t prediction;
+                switch (f) {
+                    case 1: prediction = left; break;
+                    case 2: prediction = up[i]; break;
+                    case 3: prediction = (uint8_t) ((left + up[i]) / 2); break;
+                    case 4: prediction = paeth(left, up[i], up_left); break;
+                    default: prediction = 0; break;
+                }
+                out[i + 1] = (uint8_t) (row[i] - prediction);
+                sum += abs((int8_t) out[i + 1]);
+            }
+            if (sum < best_sum) {
+                best_sum = sum;
+                best = f;
+            }
+        }
+
+        put_data(t_writer, &t_writer->m_filtered_rows[(size_t) best * (row_size + 1)], row_size + 1);
+        memcpy(t_writer->m_previous_row, row, row_size);
+        t_writer->m_rows_written++;
+    }
+
+    return t_writer->m_failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
+
+int delete_png_writer(png_writer_t *t_writer)
+{
+    bool complete = t_writer->m_rows_written == t_writer->m_height;
+    if (complete) {
+        /** end the block, and add an empty final one since the open block could not be marked as final */
+        put_symbol(t_writer, 256);
+        put_bits(t_writer, 1, 1); // final block
+        put_bits(t_writer, 1, 2); // fixed Huffman codes
+        put_symbol(t_writer, 256);
+        put_bits(t_writer, 0, (8 - t_writer->m_bit_count) % 8); // pad to a byte
+
+        uint8_t adler[4];
+        store_u32(adler, (t_writer->m_adler_b << 16) | t_writer->m_adler_a);
+        for (uint32_t i = 0; i < 4; i++) {
+            put_byte(t_writer, adler[i]);
+        }
+        if (t_writer->m_chunk_size > 0) {
+            write_chunk(t_writer, "IDAT", t_writer->m_chunk, t_writer->m_chunk_size);
+        }
+        write_chunk(t_writer, "IEND", NULL, 0);
+    }
+
+    bool closed = fclose(t_writer->m_file) == 0;
+    free(t_writer->m_chunk);
+    free(t_writer->m_filtered_rows);
+    free(t_writer->m_previous_row);
+
+    return complete && closed && !t_writer->m_failed ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,57 @@
+#ifndef MANDELBROT_PNG_WRITER_H
+#define MANDELBROT_PNG_WRITER_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+/**
+ * Writes a png row by row, so that an image never has to be in memory as a whole. Every row is filtered with
+ * the filter that minimizes the sum of its absolute differences, and compressed in a single deflate block
+ * with the fixed Huffman codes. Only runs of a repeated byte are matched, which compresses the uniform regions
+ * of a fractal well and keeps the writer fast and without a window to search. */
+typedef struct {
+    FILE *m_file;
+    uint32_t m_width;
+    uint32_t m_height;
+    /** Bytes per pixel, 3 for RGB and 4 for RGBA. */
+    uint32_t m_channels;
+    uint32_t m_rows_written;
+    /** Set once writing to the file failed, after which nothing is written anymore. */
+    bool m_failed;
+
+    /** Previous row, for the filters that refer to it, and the current row with every filter applied. */
+    uint8_t *m_previous_row;
+    uint8_t *m_filtered_rows;
+
+    /** Last byte of the uncompressed stream, a run of it is encoded as a match at a distance of one. */
+    int32_t m_last_byte;
+    /** Adler-32 checksum of the uncompressed stream, kept as its two sums. */
+    uint32_t m_adler_a;
+    uint32_t m_adler_b;
+    /** Compressed bits that do not fill a byte yet, least significant first. */
+    uint64_t m_bits;
+    uint32_t m_bit_count;
+
+    /** Compressed bytes of the next IDAT chunk, written once it is full. */
+    uint8_t *m_chunk;
+    uint32_t m_chunk_size;
+} png_writer_t;
+
+/**
+ * Creates {t_path} and writes the header of an 8-bit image of {t_width} by {t_height} pixels with {t_channels}
+ * channels, 3 or 4. Returns {EXIT_FAILURE} if the file could not be created or memory for the rows and the
+ * compressed data could not be allocated. Call to {delete_png_writer} is required if {EXIT_SUCCESS} is returned. */
+int create_png_writer(
+        png_writer_t *t_writer, const char *t_path, uint32_t t_width, uint32_t t_height, uint32_t t_channels
+);
+
+/** Compresses and writes {t_count} rows of {t_pixels}, which holds {m_channels} bytes per pixel. */
+int png_writer_write_rows(png_writer_t *t_writer, const uint8_t *t_pixels, uint32_t t_count);
+
+/**
+ * Completes the file and closes it. Returns {EXIT_FAILURE} if not all rows were written or writing failed,
+ * in which case the file is incomplete. */
+int delete_png_writer(png_writer_t *t_writer);
+
+#endif //MANDELBROT_PNG_WRITER_H
@@ -0,0 +1,274 @@
+#include <stdlib.h>
+#include <unistd.h>
+#include "thread_pool.h"
+#include "log.h"
+
+// initial number of tasks a deque can hold before it grows
+static const uint32_t INITIAL_DEQUE_CAPACITY = 64;
+
+typedef struct {
+    thread_pool_t *m_pool;
+    uint32_t m_index;
+} worker_arg_t;
+
+static int create_deque(task_deque_t *t_deque)
+{
+    if ((t_deque->m_tasks = malloc(INITIAL_DEQUE_CAPACITY * sizeof(task_t))) == NULL) {
+        nm_log(LOG_ERROR, "could not allocate memory for task deque\n");
+
+        return EXIT_FAILURE;
+    }
+
+    t_deque->m_capacity = INITIAL_DEQUE_CAPACITY;
+    t_deque->m_head = 0;
+    t_deque->m_count = 0;
+    pthread_mutex_init(&t_deque->m_mutex, NULL);
+
+    return EXIT_SUCCESS;
+}
+
+static void delete_deque(task_deque_t *t_deque)
+{
+    pthread_mutex_destroy(&t_deque->m_mutex);
+    free(t_deque->m_tasks);
+}
+
+static int deque_push(task_deque_t *t_deque, task_t t_task)
+{
+    pthread_mutex_lock(&t_deque->m_mutex);
+    {
+        if (t_deque->m_count == t_deque->m_capacity) {
+            // grow the ring buffer, unwrapping it in the process
+            task_t *tasks = malloc(2 * t_deque->m_capacity * sizeof(task_t));
+            if (tasks == NULL) {
+                pthread_mutex_unlock(&t_deque->m_mutex);
+                nm_log(LOG_ERROR, "could not grow task deque\n");
+
+                return EXIT_FAILURE;
+            }
+            for (uint32_t i = 0; i < t_deque->m_count; i++) {
+                tasks[i] = t_deque->m_tasks[(t_deque->m_head + i) % t_deque->m_capacity];
+            }
+            free(t_deque->m_tasks);
+            t_deque->m_tasks = tasks;
+            t_deque->m_capacity *= 2;
+            t_deque->m_head = 0;
+        }
+
+        t_deque->m_tasks[(t_deque->m_head + t_deque->m_count) % t_deque->m_capacity] = t_task;
+        t_deque->m_count++;
+    }
+    pthread_mutex_unlock(&t_deque->m_mutex);
+
+    return EXIT_SUCCESS;
+}
+
+/** Takes the newest task, used by the owner of the deque. */
+static bool deque_pop(task_deque_t *t_deque, task_t *t_task)
+{
+    bool found = false;
+    pthread_mutex_lock(&t_deque->m_mutex);
+    {
+        if (t_deque->m_count > 0) {
+            t_deque->m_count--;
+            *t_task = t_deque->m_tasks[(t_deque->m_head + t_deque->m_count) % t_deque->m_capacity];
+            found = true;
+        }
+    }
+    pthread_mutex_unlock(&t_deque->m_mutex);
+
+    return found;
+}
+
+/** Takes the oldest task, used by other workers. */
+static bool deque_steal(task_deque_t *t_deque, task_t *t_task)
+{
+    bool found = false;
+    pthread_mutex_lock(&t_deque->m_mutex);
+    {
+        if (t_deque->m_count > 0) {
+            *t_task = t_deque->m_tasks[t_deque->m_head];
+            t_deque->m_head = (t_deque->m_head + 1) % t_deque->m_capacity;
+            t_deque->m_count--;
+            found = true;
+        }
+    }
+    pthread_mutex_unlock(&t_deque->m_mutex);
+
+    return found;
+}
+
+/** Finds a task for worker {t_index}, first in its own deque and otherwise in those of the other workers. */
+static bool find_task(thread_pool_t *t_pool, uint32_t t_index, task_t *t_task)
+{
+    if (deque_pop(&t_pool->m_deques[t_index], t_task)) {
+        return true;
+    }
+
+    for (uint32_t i = 1; i < t_pool->m_num_workers; i++) {
+        if (deque_steal(&t_pool->m_deques[(t_index + i) % t_pool->m_num_workers], t_task)) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+static void *worker_function(void *vargp)
+{
+    worker_arg_t *arg = vargp;
+    thread_pool_t *pool = arg->m_pool;
+
+    while (1) {
+        task_t task;
+        if (find_task(pool, arg->m_index, &task)) {
+            atomic_fetch_sub(&pool->m_queued, 1);
+
+            task.m_fun(task.m_arg, arg->m_index);
+
+            if (atomic_fetch_sub(&pool->m_pending, 1) == 1) {
+                pthread_mutex_lock(&pool->m_mutex);
+                {
+                    pthread_cond_broadcast(&pool->m_done_cv);
+                }
+                pthread_mutex_unlock(&pool->m_mutex);
+            }
+
+            continue;
+        }
+
+        // no task found, sleep until new tasks are queued
+        bool stop;
+        pthread_mutex_lock(&pool->m_mutex);
+        {
+            while (!pool->m_stop && atomic_load(&pool->m_queued) == 0) {
+                pthread_cond_wait(&pool->m_work_cv, &pool->m_mutex);
+            }
+            stop = pool->m_stop;
+        }
+        pthread_mutex_unlock(&pool->m_mutex);
+
+        if (stop) break;
+    }
+
+    return NULL;
+}
+
+int create_thread_pool(thread_pool_t *t_pool, uint32_t t_num_workers)
+{
+    if (t_num_workers == 0) {
+        long online = sysconf(_SC_NPROCESSORS_ONLN);
+        t_num_workers = online > 0 ? (uint32_t) online : 1;
+    }
+
+    t_pool->m_num_workers = t_num_workers;
+    t_pool->m_stop = false;
+    atomic_init(&t_pool->m_next_worker, 0);
+    atomic_init(&t_pool->m_queued, 0);
+    atomic_init(&t_pool->m_pending, 0);
+
+    t_pool->m_threads = malloc(t_num_workers * sizeof(pthread_t));
+    t_pool->m_deques = malloc(t_num_workers * sizeof(task_deque_t));
+    worker_arg_t *args = malloc(t_num_workers * sizeof(worker_arg_t));
+    if (t_pool->m_threads == NULL || t_pool->m_deques == NULL || args == NULL) {
+        nm_log(LOG_ERROR, "could not allocate memory for thread pool\n");
+        free(args);
+        free(t_pool->m_deques);
+        free(t_pool->m_threads);
+
+        return EXIT_FAILURE;
+    }
+
+    for (uint32_t i = 0; i < t_num_workers; i++) {
+        if (create_deque(&t_pool->m_deques[i]) == EXIT_FAILURE) {
+            nm_log(LOG_ERROR, "could not create the deque of worker %u\n", i);
+            for (uint32_t j = 0; j < i; j++) {
+                delete_deque(&t_pool->m_deques[j]);
+            }
+            free(args);
+            free(t_pool->m_deques);
+            free(t_pool->m_threads);
+
+            return EXIT_FAILURE;
+        }
+    }
+
+    pthread_mutex_init(&t_pool->m_mutex, NULL);
+    pthread_cond_init(&t_pool->m_work_cv, NULL);
+    pthread_cond_init(&t_pool->m_done_cv, NULL);
+
+    // workers keep a pointer to their argument, so it lives as long as the pool
+    for (uint32_t i = 0; i < t_num_workers; i++) {
+        args[i].m_pool = t_pool;
+        args[i].m_index = i;
+        pthread_create(&t_pool->m_threads[i], NULL, worker_function, &args[i]);
+    }
+    t_pool->m_worker_args = args;
+
+    nm_log(LOG_INFO, "created thread pool with %u workers\n", t_num_workers);
+
+    return EXIT_SUCCESS;
+}
+
+void delete_thread_pool(thread_pool_t *t_pool)
+{
+    pthread_mutex_lock(&t_pool->m_mutex);
+    {
+        t_pool->m_stop = true;
+        pthread_cond_broadcast(&t_pool->m_work_cv);
+    }
+    pthread_mutex_unlock(&t_pool->m_mutex);
+
+    for (uint32_t i = 0; i < t_pool->m_num_workers; i++) {
+        pthread_join(t_pool->m_threads[i], NULL);
+    }
+
+    pthread_cond_destroy(&t_pool->m_done_cv);
+    pthread_cond_destroy(&t_pool->m_work_cv);
+    pthread_mutex_destroy(&t_pool->m_mutex);
+
+    for (uint32_t i = 0; i < t_pool->m_num_workers; i++) {
+        delete_deque(&t_pool->m_deques[i]);
+    }
+
+    free(t_pool->m_worker_args);
+    free(t_pool->m_deques);
+    free(t_pool->m_threads);
+}
+
+int thread_pool_submit(thread_pool_t *t_pool, task_fun_t t_fun, void *t_arg)
+{
+    task_t task = {.m_fun = t_fun, .m_arg = t_arg};
+
+    // spread tasks round-robin, stealing evens out the remaining imbalance
+    uint32_t worker = atomic_fetch_add(&t_pool->m_next_worker, 1) % t_pool->m_num_workers;
+
+    // counters are raised before the push, so they never drop below zero when the task is taken right away
+    atomic_fetch_add(&t_pool->m_pending, 1);
+    atomic_fetch_add(&t_pool->m_queued, 1);
+    if (deque_push(&t_pool->m_deques[worker], task) == EXIT_FAILURE) {
+        atomic_fetch_sub(&t_pool->m_queued, 1);
+        atomic_fetch_sub(&t_pool->m_pending, 1);
+
+        return EXIT_FAILURE;
+    }
+
+    pthread_mutex_lock(&t_pool->m_mutex);
+    {
+        pthread_cond_signal(&t_pool->m_work_cv);
+    }
+    pthread_mutex_unlock(&t_pool->m_mutex);
+
+    return EXIT_SUCCESS;
+}
+
+void thread_pool_wait(thread_pool_t *t_pool)
+{
+    pthread_mutex_lock(&t_pool->m_mutex);
+    {
+        while (atomic_load(&t_pool->m_pending) != 0) {
+            pthread_cond_wait(&t_pool->m_done_cv, &t_pool->m_mutex);
+        }
+    }
+    pthread_mutex_unlock(&t_pool->m_mutex);
+}
@@ -0,0 +1,71 @@
+#ifndef MANDELBROT_THREAD_POOL_H
+#define MANDELBROT_THREAD_POOL_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdatomic.h>
+#include <pthread.h>
+
+/** Function executed by a worker, {t_worker} is the index of that worker in [0, number of workers). */
+typedef void (*task_fun_t)(void *t_arg, uint32_t t_worker);
+
+typedef struct {
+    task_fun_t m_fun;
+    void *m_arg;
+} task_t;
+
+/** Double-ended queue of tasks owned by a single worker. */
+typedef struct {
+    pthread_mutex_t m_mutex;
+    /** Ring buffer of tasks. */
+    task_t *m_tasks;
+    uint32_t m_capacity;
+    /** Index of the oldest task, which is taken by thieves. */
+    uint32_t m_head;
+    /** Number of tasks in the deque, the newest is taken by the owner. */
+    uint32_t m_count;
+} task_deque_t;
+
+typedef struct {
+    uint32_t m_num_workers;
+    pthread_t *m_threads;
+    /** One deque per worker. */
+    task_deque_t *m_deques;
+    /** Arguments passed to the worker threads. */
+    void *m_worker_args;
+
+    /** Worker the next submitted task is placed at. */
+    atomic_uint m_next_worker;
+
+    /** Number of tasks in all deques. */
+    atomic_uint m_queued;
+    /** Number of tasks submitted and not yet finished. */
+    atomic_uint m_pending;
+
+    /** Protects waiting on and signaling {m_work_cv} and {m_done_cv}. */
+    pthread_mutex_t m_mutex;
+    /** Signaled when tasks are submitted or the pool stops. */
+    pthread_cond_t m_work_cv;
+    /** Signaled when {m_pending} drops to zero. */
+    pthread_cond_t m_done_cv;
+
+    bool m_stop;
+} thread_pool_t;
+
+/**
+ * Creates a pool of {t_num_workers} threads, or one per online processor if {t_num_workers} is 0.
+ * Call to {delete_thread_pool} is required if {EXIT_SUCCESS} is returned. */
+int create_thread_pool(thread_pool_t *t_pool, uint32_t t_num_workers);
+
+/** Stops and joins all workers, tasks that are still queued are not executed. */
+void delete_thread_pool(thread_pool_t *t_pool);
+
+/**
+ * Queues a task. Tasks are spread over the workers, and idle workers steal tasks from busy ones. Returns
+ * {EXIT_FAILURE} if the task could not be queued, in which case it is not executed. */
+int thread_pool_submit(thread_pool_t *t_pool, task_fun_t t_fun, void *t_arg);
+
+/** Blocks until all submitted tasks are finished, including tasks submitted by tasks. Must not be called by a task. */
+void thread_pool_wait(thread_pool_t *t_pool);
+
+#endif //MANDELBROT_THREAD_POOL_H
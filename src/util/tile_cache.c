@@ -0,0 +1,145 @@
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+#include "tile_cache.h"
+#include "log.h"
+
+void create_tile_cache(tile_cache_t *t_cache, size_t t_budget)
+{
+    memset(t_cache, 0, sizeof(tile_cache_t));
+    t_cache->m_budget = t_budget;
+    pthread_mutex_init(&t_cache->m_mutex, NULL);
+    pthread_cond_init(&t_cache->m_cv, NULL);
+}
+
+void delete_tile_cache(tile_cache_t *t_cache)
+{
+    for (uint32_t i = 0; i < t_cache->m_count; i++) {
+        free(t_cache->m_entries[i].m_data);
+    }
+    free(t_cache->m_entries);
+    pthread_cond_destroy(&t_cache->m_cv);
+    pthread_mutex_destroy(&t_cache->m_mutex);
+}
+
+/** Deletes the entry at {t_index}, moving the last entry into its place. */
+static void remove_entry(tile_cache_t *t_cache, uint32_t t_index)
+{
+    tile_cache_entry_t *entry = &t_cache->m_entries[t_index];
+    t_cache->m_size -= entry->m_size;
+    free(entry->m_data);
+    *entry = t_cache->m_entries[--t_cache->m_count];
+}
+
+/** Returns the index of the entry of the tile, or {m_count} if there is none. */
+static uint32_t find_entry(const tile_cache_t *t_cache, uint32_t t_z, uint64_t t_x, uint64_t t_y)
+{
+    uint32_t i = 0;
+    while (i < t_cache->m_count) {
+        const tile_cache_entry_t *entry = &t_cache->m_entries[i];
+        if (entry->m_z == t_z && entry->m_x == t_x && entry->m_y == t_y) break;
+        i++;
+    }
+    return i;
+}
+
+tile_lookup_t tile_cache_get(
+        tile_cache_t *t_cache, uint32_t t_z, uint64_t t_x, uint64_t t_y, uint8_t **t_data, size_t *t_size
+)
+{
+    tile_lookup_t result;
+    pthread_mutex_lock(&t_cache->m_mutex);
+    {
+        // a pending tile may also be dropped by a failed render, after which this request renders it
+        bool waited = false;
+        uint32_t index = find_entry(t_cache, t_z, t_x, t_y);
+        while (index < t_cache->m_count && t_cache->m_entries[index].m_pending) {
+            waited = true;
+            pthread_cond_wait(&t_cache->m_cv, &t_cache->m_mutex);
+            index = find_entry(t_cache, t_z, t_x, t_y);
+        }
+
+        *t_data = NULL;
+        *t_size = 0;
+        if (index < t_cache->m_count) {
+            tile_cache_entry_t *entry = &t_cache->m_entries[index];
+            entry->m_last_used = t_cache->m_clock++;
+            result = TILE_ERROR;
+            if ((*t_data = malloc(entry->m_size)) != NULL) {
+                memcpy(*t_data, entry->m_data, entry->m_size);
+                *t_size = entry->m_size;
+                result = waited ? TILE_SHARED : TILE_HIT;
+            }
+        } else {
+            result = TILE_MISS;
+            if (t_cache->m_count == t_cache->m_capacity) {
+                uint32_t capacity = t_cache->m_capacity == 0 ? 64 : t_cache->m_capacity * 2;
+                tile_cache_entry_t *entries = realloc(t_cache->m_entries, sizeof(tile_cache_entry_t) * capacity);
+                if (entries != NULL) {
+                    t_cache->m_entries = entries;
+                    t_cache->m_capacity = capacity;
+                } else {
+                    result = TILE_ERROR;
+                }
+            }
+            if (result == TILE_MISS) {
+                t_cache->m_entries[t_cache->m_count++] = (tile_cache_entry_t) {
+                        .m_z = t_z, .m_x = t_x, .m_y = t_y, .m_pending = true, .m_last_used = t_cache->m_clock++,
+                };
+            }
+        }
+
+        switch (result) {
+            case TILE_HIT: t_cache->m_hits++; break;
+            case TILE_SHARED: t_cache->m_shared++; break;
+            case TILE_MISS: t_cache->m_misses++; break;
+            case TILE_ERROR: break;
+        }
+    }
+    pthread_mutex_unlock(&t_cache->m_mutex);
+
+    if (result == TILE_ERROR) {
+        nm_log(LOG_ERROR, "could not allocate memory to look up tile %u/%" PRIu64 "/%" PRIu64 "\n", t_z, t_x, t_y);
+    }
+
+    return result;
+}
+
+void tile_cache_complete(
+        tile_cache_t *t_cache, uint32_t t_z, uint64_t t_x, uint64_t t_y, uint8_t *t_data, size_t t_size
+)
+{
+    pthread_mutex_lock(&t_cache->m_mutex);
+    {
+        uint32_t index = find_entry(t_cache, t_z, t_x, t_y);
+        if (t_data == NULL) {
+            remove_entry(t_cache, index);
+        } else {
+            // evict the least recently used tiles until it fits, pending tiles are not evicted and neither is
+            // this one, which the waiting requests are about to copy
+            while (t_cache->m_size + t_size > t_cache->m_budget) {
+                uint32_t oldest = t_cache->m_count;
+                for (uint32_t i = 0; i < t_cache->m_count; i++) {
+                    const tile_cache_entry_t *entry = &t_cache->m_entries[i];
+                    if (entry->m_pending) continue;
+                    if (oldest == t_cache->m_count || entry->m_last_used < t_cache->m_entries[oldest].m_last_used) {
+                        oldest = i;
+                    }
+                }
+                if (oldest == t_cache->m_count) break;
+                remove_entry(t_cache, oldest);
+                // the entry may have been moved into the place of the evicted one
+                index = find_entry(t_cache, t_z, t_x, t_y);
+            }
+
+            tile_cache_entry_t *entry = &t_cache->m_entries[index];
+            entry->m_pending = false;
+            entry->m_last_used = t_cache->m_clock++;
+            entry->m_data = t_data;
+            entry->m_size = t_size;
+            t_cache->m_size += t_size;
+        }
+        pthread_cond_broadcast(&t_cache->m_cv);
+    }
+    pthread_mutex_unlock(&t_cache->m_mutex);
+}
@@ -0,0 +1,81 @@
+#ifndef MANDELBROT_TILE_CACHE_H
+#define MANDELBROT_TILE_CACHE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <pthread.h>
+
+typedef struct {
+    /** Zoom level and position of the tile, see {tile_server_t}. */
+    uint32_t m_z;
+    uint64_t m_x, m_y;
+    /** Set while the tile is rendered by the request that missed it, other requests for it wait. */
+    bool m_pending;
+    /** Value of {m_clock} when the entry was last used, the smallest is evicted first. */
+    uint64_t m_last_used;
+    /** Encoded tile, NULL while pending. */
+    uint8_t *m_data;
+    size_t m_size;
+} tile_cache_entry_t;
+
+/** Result of {tile_cache_get}. */
+typedef enum {
+    /** The tile was in the cache. */
+    TILE_HIT,
+    /** The tile was being rendered for another request, which was waited for. */
+    TILE_SHARED,
+    /** The tile is now pending, the caller renders it and passes it to {tile_cache_complete}. */
+    TILE_MISS,
+    /** The tile could not be copied or marked pending, as memory could not be allocated. */
+    TILE_ERROR,
+} tile_lookup_t;
+
+/**
+ * Encoded tiles, of which the least recently used are evicted once they exceed a budget. Safe to use from
+ * multiple threads. A tile that is requested while it is rendered is not rendered again, the request waits
+ * for the render in progress instead. */
+typedef struct {
+    tile_cache_entry_t *m_entries;
+    uint32_t m_count;
+    uint32_t m_capacity;
+    /** Bytes the tiles may hold together. */
+    size_t m_budget;
+    /** Bytes the tiles hold together, exceeds {m_budget} only if the last completed tile does not fit. */
+    size_t m_size;
+    uint64_t m_clock;
+
+    /** Number of results of {tile_cache_get} of every kind. */
+    uint64_t m_hits;
+    uint64_t m_shared;
+    uint64_t m_misses;
+
+    /** Protects all of the above. */
+    pthread_mutex_t m_mutex;
+    /** Signaled when a pending tile is completed. */
+    pthread_cond_t m_cv;
+} tile_cache_t;
+
+/** Creates an empty cache, call to {delete_tile_cache} is required. */
+void create_tile_cache(tile_cache_t *t_cache, size_t t_budget);
+
+/** Deletes the cache and all tiles in it. */
+void delete_tile_cache(tile_cache_t *t_cache);
+
+/**
+ * Looks up tile {t_x}, {t_y} of zoom level {t_z}, waiting if it is pending. On a hit, a copy of the tile is
+ * placed in {t_data}, which is freed by the caller, and its size in {t_size}. On a miss, the tile is marked
+ * pending and the caller is required to call {tile_cache_complete} for it. On an error, neither is done and the
+ * result is not counted. */
+tile_lookup_t tile_cache_get(
+        tile_cache_t *t_cache, uint32_t t_z, uint64_t t_x, uint64_t t_y, uint8_t **t_data, size_t *t_size
+);
+
+/**
+ * Stores the rendered pending tile, taking ownership of {t_data}, and wakes the requests that wait for it.
+ * A {t_data} of NULL means the render failed, which drops the tile so that the next request renders it. */
+void tile_cache_complete(
+        tile_cache_t *t_cache, uint32_t t_z, uint64_t t_x, uint64_t t_y, uint8_t *t_data, size_t t_size
+);
+
+#endif //MANDELBROT_TILE_CACHE_H
@@ -0,0 +1,318 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+#include <time.h>
+#include <math.h>
+#include <unistd.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include "tile_server.h"
+#include "log.h"
+
+// limit to the size of the request line and headers of a request, longer requests are refused
+#define REQUEST_SIZE 4096
+// seconds a connection may take to send its request
+#define REQUEST_TIMEOUT 5
+// milliseconds between checks of whether to stop
+#define POLL_INTERVAL 250
+
+/** Connection answered by its own thread. */
+typedef struct {
+    tile_server_t *m_server;
+    int m_socket;
+} connection_t;
+
+int create_tile_server(
+        tile_server_t *t_server, uint16_t t_port, uint32_t t_max_zoom, size_t t_cache_budget,
+        tile_render_fun_t t_render, void *t_render_arg
+)
+{
+    memset(t_server, 0, sizeof(tile_server_t));
+    t_server->m_max_zoom = t_max_zoom;
+    t_server->m_render = t_render;
+    t_server->m_render_arg = t_render_arg;
+
+    t_server->m_socket = socket(AF_INET, SOCK_STREAM, 0);
+    if (t_server->m_socket < 0) {
+        nm_log(LOG_ERROR, "failed to create a socket\n");
+        return EXIT_FAILURE;
+    }
+    int reuse = 1;
+    setsockopt(t_server->m_socket, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+
+    // only reachable from this machine
+    struct sockaddr_in address = {0};
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    address.sin_port = htons(t_port);
+    if (bind(t_server->m_socket, (struct sockaddr *) &address, sizeof(address)) != 0 ||
+        listen(t_server->m_socket, SOMAXCONN) != 0) {
+        nm_log(LOG_ERROR, "failed to listen on port %u\n", t_port);
+        close(t_server->m_socket);
+        return EXIT_FAILURE;
+    }
+
+    create_tile_cache(&t_server->m_cache, t_cache_budget);
+    atomic_init(&t_server->m_connections, 0);
+    pthread_mutex_init(&t_server->m_mutex, NULL);
+    nm_log(LOG_INFO, "serving tiles at http://127.0.0.1:%u/{z}/{x}/{y}.png\n", t_port);
+
+    return EXIT_SUCCESS;
+}
+
+void delete_tile_server(tile_server_t *t_server)
+{
+    close(t_server->m_socket);
+
+    // connections render with the renderer, which may be deleted once this returns
+    struct timespec interval = {0, 10 * 1000 * 1000};
+    while (atomic_load(&t_server->m_connections) > 0) {
+        nanosleep(&interval, NULL);
+    }
+
+    pthread_mutex_destroy(&t_server->m_mutex);
+    delete_tile_cache(&t_server->m_cache);
+}
+
+/** Sends all {t_size} bytes of {t_data}, returns whether the connection took them. */
+static bool send_all(int t_socket, const void *t_data, size_t t_size)
+{
+    const uint8_t *data = t_data;
+    while (t_size > 0) {
+        // a client that hung up must not raise SIGPIPE
+        ssize_t sent = send(t_socket, data, t_size, MSG_NOSIGNAL);
+        if (sent <= 0) return false;
+        data += sent;
+        t_size -= (size_t) sent;
+    }
+
+    return true;
+}
+
+/** Sends a response with {t_status}, such as "200 OK", and {t_size} bytes of {t_body} of {t_type}. */
+static void send_response(
+        int t_socket, const char *t_status, const char *t_type, const char *t_cache, const void *t_body,
+        size_t t_size
+)
+{
+    char header[512];
+    int length = snprintf(
+            header, sizeof(header),
+            "HTTP/1.1 %s\r\nContent-Type: %s\r\nContent-Length: %zu\r\n%s%s%sConnection: close\r\n\r\n",
+            t_status, t_type, t_size, t_cache != NULL ? "X-Cache: " : "", t_cache != NULL ? t_cache : "",
+            t_cache != NULL ? "\r\n" : ""
+    );
+    if (send_all(t_socket, header, (size_t) length)) {
+        send_all(t_socket, t_body, t_size);
+    }
+}
+
+static void send_error(int t_socket, const char *t_status)
+{
+    char body[64];
+    int length = snprintf(body, sizeof(body), "%s\n", t_status);
+    send_response(t_socket, t_status, "text/plain", NULL, body, (size_t) length);
+}
+
+static double elapsed_seconds(const struct timespec *t_start)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    return (double) (now.tv_sec - t_start->tv_sec) + (now.tv_nsec - t_start->tv_nsec) * 1e-9;
+}
+
+/** Answers a request for tile {t_x}, {t_y} of zoom level {t_z}, from the cache or by rendering it. */
+static void answer_tile(tile_server_t *t_server, int t_socket, uint32_t t_z, uint64_t t_x, uint64_t t_y)
+{
+    uint8_t *data;
+    size_t size;
+    tile_lookup_t lookup = tile_cache_get(&t_server->m_cache, t_z, t_x, t_y, &data, &size);
+    if (lookup == TILE_ERROR) {
+        send_error(t_socket, "500 Internal Server Error");
+        return;
+    }
+    if (lookup == TILE_HIT || lookup == TILE_SHARED) {
+        send_response(t_socket, "200 OK", "image/png", lookup == TILE_HIT ? "hit" : "shared", data, size);
+        free(data);
+        return;
+    }
+
+    struct timespec start;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    if (t_server->m_render(t_z, t_x, t_y, &data, &size, t_server->m_render_arg) == EXIT_FAILURE) {
+        nm_log(LOG_ERROR, "failed to render tile %u/%" PRIu64 "/%" PRIu64 "\n", t_z, t_x, t_y);
+        tile_cache_complete(&t_server->m_cache, t_z, t_x, t_y, NULL, 0);
+        send_error(t_socket, "500 Internal Server Error");
+        return;
+    }
+    double latency = elapsed_seconds(&start);
+
+    pthread_mutex_lock(&t_server->m_mutex);
+    {
+        t_server->m_latencies[t_server->m_render_count++ % TILE_LATENCY_SAMPLES] = latency;
+    }
+    pthread_mutex_unlock(&t_server->m_mutex);
+
+    // the cache takes a copy, which may be evicted while this one is sent, and wakes the waiting requests
+    uint8_t *copy = malloc(size);
+    if (copy == NULL) {
+        nm_log(LOG_ERROR, "could not allocate memory to cache tile %u/%" PRIu64 "/%" PRIu64 "\n", t_z, t_x, t_y);
+        tile_cache_complete(&t_server->m_cache, t_z, t_x, t_y, NULL, 0);
+        send_error(t_socket, "500 Internal Server Error");
+        free(data);
+        return;
+    }
+    memcpy(copy, data, size);
+    tile_cache_complete(&t_server->m_cache, t_z, t_x, t_y, copy, size);
+    send_response(t_socket, "200 OK", "image/png", "miss", data, size);
+    free(data);
+}
+
+static void *answer_connection(void *t_arg)
+{
+    connection_t *connection = t_arg;
+    tile_server_t *server = connection->m_server;
+    int socket = connection->m_socket;
+    free(connection);
+
+    /** read up to the end of the headers, so that the connection is not reset by closing it with unread data */
+    char request[REQUEST_SIZE + 1];
+    size_t size = 0;
+    request[0] = '\0';
+    while (size < REQUEST_SIZE && strstr(request, "\r\n\r\n") == NULL) {
+        ssize_t received = recv(socket, &request[size], REQUEST_SIZE - size, 0);
+        if (received <= 0) break;
+        size += (size_t) received;
+        request[size] = '\0';
+    }
+
+    char method[8], path[256];
+    uint32_t z;
+    uint64_t x, y;
+    int end = 0;
+    if (strstr(request, "\r\n\r\n") == NULL || sscanf(request, "%7s %255s", method, path) != 2) {
+        send_error(socket, "400 Bad Request");
+    } else if (strcmp(method, "GET") != 0) {
+        send_error(socket, "405 Method Not Allowed");
+    } else if (strcmp(path, "/stats") == 0) {
+        char text[1024];
+        tile_server_stats(server, text, sizeof(text));
+        send_response(socket, "200 OK", "text/plain", NULL, text, strlen(text));
+    } else if (sscanf(path, "/%u/%" SCNu64 "/%" SCNu64 ".png%n", &z, &x, &y, &end) == 3 && end > 0 &&
+               path[end] == '\0' && z <= server->m_max_zoom && x < (1ull << z) && y < (1ull << z)) {
+        answer_tile(server, socket, z, x, y);
+    } else {
+        send_error(socket, "404 Not Found");
+    }
+
+    close(socket);
+    atomic_fetch_sub(&server->m_connections, 1);
+
+    return NULL;
+}
+
+void tile_server_run(tile_server_t *t_server, volatile sig_atomic_t *t_stop)
+{
+    pthread_attr_t attributes;
+    pthread_attr_init(&attributes);
+    pthread_attr_setdetachstate(&attributes, PTHREAD_CREATE_DETACHED);
+
+    struct pollfd listener = {t_server->m_socket, POLLIN, 0};
+    while (!*t_stop) {
+        if (poll(&listener, 1, POLL_INTERVAL) <= 0) continue;
+        int socket = accept(t_server->m_socket, NULL, NULL);
+        if (socket < 0) continue;
+
+        // renders take turns, so a burst of requests would otherwise pile up blocked threads
+        if (atomic_load(&t_server->m_connections) >= TILE_MAX_CONNECTIONS) {
+            // what the request sent so far is read without waiting, so that closing does not reset the connection
+            char request[REQUEST_SIZE];
+            while (recv(socket, request, sizeof(request), MSG_DONTWAIT) > 0);
+            send_error(socket, "503 Service Unavailable");
+            close(socket);
+            continue;
+        }
+
+        // a client that does not send its request does not hold on to its thread
+        struct timeval timeout = {REQUEST_TIMEOUT, 0};
+        setsockopt(socket, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+
+        connection_t *connection = malloc(sizeof(connection_t));
+        if (connection == NULL) {
+            nm_log(LOG_WARN, "could not allocate memory for a connection\n");
+            close(socket);
+            continue;
+        }
+        connection->m_server = t_server;
+        connection->m_socket = socket;
+        atomic_fetch_add(&t_server->m_connections, 1);
+        pthread_t thread;
+        if (pthread_create(&thread, &attributes, answer_connection, connection) != 0) {
+            nm_log(LOG_WARN, "failed to create a thread for a connection\n");
+            atomic_fetch_sub(&t_server->m_connections, 1);
+            close(socket);
+            free(connection);
+        }
+    }
+
+    pthread_attr_destroy(&attributes);
+}
+
+static int compare_doubles(const void *t_a, const void *t_b)
+{
+    double a = *(const double *) t_a, b = *(const double *) t_b;
+    return (a > b) - (a < b);
+}
+
+void tile_server_stats(tile_server_t *t_server, char *t_text, size_t t_size)
+{
+    tile_cache_t *cache = &t_server->m_cache;
+    uint64_t hits, shared, misses;
+    uint32_t tile_count;
+    size_t cache_size;
+    pthread_mutex_lock(&cache->m_mutex);
+    {
+        hits = cache->m_hits;
+        shared = cache->m_shared;
+        misses = cache->m_misses;
+        tile_count = cache->m_count;
+        cache_size = cache->m_size;
+    }
+    pthread_mutex_unlock(&cache->m_mutex);
+
+    double latencies[TILE_LATENCY_SAMPLES];
+    uint32_t count;
+    pthread_mutex_lock(&t_server->m_mutex);
+    {
+        count = t_server->m_render_count < TILE_LATENCY_SAMPLES ? t_server->m_render_count : TILE_LATENCY_SAMPLES;
+        memcpy(latencies, t_server->m_latencies, sizeof(double) * count);
+    }
+    pthread_mutex_unlock(&t_server->m_mutex);
+    qsort(latencies, count, sizeof(double), compare_doubles);
+
+    uint64_t requests = hits + shared + misses;
+    int length = snprintf(
+            t_text, t_size,
+            "requests %" PRIu64 ", hits %" PRIu64 " (%.1f%%), shared with a render in progress %" PRIu64
+            ", rendered %" PRIu64 "\ncache %u tiles in %.1f of %.1f MiB\n", requests, hits,
+            requests > 0 ? 100. * hits / requests : 0., shared, misses, tile_count, cache_size / (1024. * 1024.),
+            cache->m_budget / (1024. * 1024.)
+    );
+    if (count > 0 && length > 0 && (size_t) length < t_size) {
+        // nearest rank, the smallest latency that at least the fraction of the renders took at most
+        const double fractions[] = {.5, .9, .99};
+        double percentiles[3];
+        for (uint32_t i = 0; i < 3; i++) {
+            percentiles[i] = latencies[(uint32_t) ceil(fractions[i] * count) - 1];
+        }
+        snprintf(
+                &t_text[length], t_size - length,
+                "render latency of the last %u: p50 %.1f ms, p90 %.1f ms, p99 %.1f ms, max %.1f ms\n", count,
+                percentiles[0] * 1e3, percentiles[1] * 1e3, percentiles[2] * 1e3, latencies[count - 1] * 1e3
+        );
+    }
+}
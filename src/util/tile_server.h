@@ -0,0 +1,65 @@
+#ifndef MANDELBROT_TILE_SERVER_H
+#define MANDELBROT_TILE_SERVER_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdatomic.h>
+#include <signal.h>
+#include <pthread.h>
+#include "tile_cache.h"
+
+/** Number of the most recent renders the latency percentiles are taken over. */
+#define TILE_LATENCY_SAMPLES 4096
+
+/** Number of connections answered at once, further ones are refused until one of them is closed. */
+#define TILE_MAX_CONNECTIONS 64
+
+/**
+ * Renders tile {t_x}, {t_y} of zoom level {t_z} into {t_data}, allocated with malloc, of {t_size} bytes. Called
+ * by several requests at once. */
+typedef int (*tile_render_fun_t)(
+        uint32_t t_z, uint64_t t_x, uint64_t t_y, uint8_t **t_data, size_t *t_size, void *t_arg
+);
+
+/**
+ * Answers HTTP requests on the loopback interface for slippy map tiles, GET /z/x/y.png for x and y in
+ * [0, 2^z), and for statistics, GET /stats. Every connection is answered by its own thread and closed after a
+ * single request, a connection beyond {TILE_MAX_CONNECTIONS} is answered with 503 right away. Tiles that are
+ * not in the cache are rendered by the renderer on a miss. */
+typedef struct {
+    int m_socket;
+    uint32_t m_max_zoom;
+    tile_render_fun_t m_render;
+    void *m_render_arg;
+    tile_cache_t m_cache;
+
+    /** Number of connections being answered. */
+    atomic_uint m_connections;
+
+    /** Seconds from the miss of a tile until it was rendered, of the last {TILE_LATENCY_SAMPLES} renders. */
+    double m_latencies[TILE_LATENCY_SAMPLES];
+    /** Number of renders, the latency of render i is at i modulo {TILE_LATENCY_SAMPLES}. */
+    uint64_t m_render_count;
+    /** Protects the latencies. */
+    pthread_mutex_t m_mutex;
+} tile_server_t;
+
+/**
+ * Listens on {t_port} of the loopback interface, for tiles up to zoom level {t_max_zoom} rendered by
+ * {t_render}, which is passed {t_render_arg}, and cached up to {t_cache_budget} bytes. Call to
+ * {delete_tile_server} is required if {EXIT_SUCCESS} is returned. */
+int create_tile_server(
+        tile_server_t *t_server, uint16_t t_port, uint32_t t_max_zoom, size_t t_cache_budget,
+        tile_render_fun_t t_render, void *t_render_arg
+);
+
+/** Waits for the connections that are being answered, and closes the socket. */
+void delete_tile_server(tile_server_t *t_server);
+
+/** Answers requests until {t_stop} is set, which is checked a few times per second. */
+void tile_server_run(tile_server_t *t_server, volatile sig_atomic_t *t_stop);
+
+/** Writes the hit rate of the cache and percentiles of the render latency as text into {t_text}. */
+void tile_server_stats(tile_server_t *t_server, char *t_text, size_t t_size);
+
+#endif //MANDELBROT_TILE_SERVER_H
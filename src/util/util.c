@@ -1,16 +1,16 @@
 // nolmoonen v1.0.0
 #include <stdlib.h>
-#include <time.h>
 #include <stdio.h>
+#include <math.h>
 
 #include "util.h"
 #include "log.h"
 
-int create_tick_buffer(circular_tick_buffer_t *t_buffer, uint64_t t_size, uint64_t t_dt)
+int create_tick_buffer(circular_tick_buffer_t *t_buffer, uint64_t t_size, double t_dt)
 {
     t_buffer->m_size = t_size;
     t_buffer->m_dt = t_dt;
-    t_buffer->m_array = malloc(t_buffer->m_size * sizeof(clock_t));
+    t_buffer->m_array = malloc(t_buffer->m_size * sizeof(double));
 
     if (t_buffer->m_array == NULL) {
         nm_log(LOG_ERROR, "could not allocate memory for tick buffer\n");
@@ -18,12 +18,16 @@ int create_tick_buffer(circular_tick_buffer_t *t_buffer, uint64_t t_size, uint64
         return EXIT_FAILURE;
     }
 
+    // timestamps that have not been added are infinitely long ago
+    for (uint64_t i = 0; i < t_buffer->m_size; i++) {
+        t_buffer->m_array[i] = -INFINITY;
+    }
     t_buffer->m_pointer = 0;
 
     return EXIT_SUCCESS;
 }
 
-int tick_buffer_add(circular_tick_buffer_t *t_buffer, clock_t t_value)
+int tick_buffer_add(circular_tick_buffer_t *t_buffer, double t_value)
 {
     t_buffer->m_array[t_buffer->m_pointer++] = t_value;
     t_buffer->m_pointer %= t_buffer->m_size;
@@ -31,7 +35,7 @@ int tick_buffer_add(circular_tick_buffer_t *t_buffer, clock_t t_value)
     return EXIT_SUCCESS;
 }
 
-uint64_t tick_buffer_query(circular_tick_buffer_t *t_buffer, clock_t t_value)
+uint64_t tick_buffer_query(circular_tick_buffer_t *t_buffer, double t_value)
 {
     uint64_t pointer_clone = t_buffer->m_pointer;
     uint64_t count = (uint64_t) -1;
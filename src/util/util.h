@@ -4,25 +4,24 @@
 
 #include <stdint.h>
 #include <stdlib.h>
-#include <time.h>
 
 typedef struct {
     uint64_t m_size;    // amount of timestamps stored
-    uint64_t m_dt;      // period in seconds over which to return timestamps
-    clock_t *m_array;   // array of timestamps in seconds
+    double m_dt;        // period in seconds over which to return timestamps
+    double *m_array;    // array of timestamps in seconds
     uint64_t m_pointer; // index of next timestamp to add
 } circular_tick_buffer_t;
 
 /**
  * Creates a buffer.
  * Every {@param t_buffer} should be deleted with a call to {@code delete_tick_buffer}. */
-int create_tick_buffer(circular_tick_buffer_t *t_buffer, uint64_t t_size, uint64_t t_dt);
+int create_tick_buffer(circular_tick_buffer_t *t_buffer, uint64_t t_size, double t_dt);
 
-/** Adds a timestamp to the array. */
-int tick_buffer_add(circular_tick_buffer_t *t_buffer, clock_t t_value);
+/** Adds a timestamp in seconds to the array, timestamps are wall clock time and added in order. */
+int tick_buffer_add(circular_tick_buffer_t *t_buffer, double t_value);
 
 /** Returns the amount of timestamps within dt distance from value. */
-uint64_t tick_buffer_query(circular_tick_buffer_t *t_buffer, clock_t t_value);
+uint64_t tick_buffer_query(circular_tick_buffer_t *t_buffer, double t_value);
 
 /** Deletes a buffer. */
 int delete_tick_buffer(circular_tick_buffer_t *t_buffer);